@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Common.hpp"
+
+using bench::Component;
+
+// ids are visited in a fixed random order, defeating the prefetcher the way
+// lookups from gameplay code would
+static void get_random(benchmark::State & state) {
+	stch::Scene scene;
+	auto ids = bench::shuffled(bench::populate<2>(scene, bench::count(state)));
+
+	for (auto _ : state) {
+		float sum = 0.f;
+		for (auto id : ids) {
+			sum += scene.get<Component<1>>(id)->m_value;
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(get_random)->Apply(bench::sizes);
+
+static void get_many_random(benchmark::State & state) {
+	stch::Scene scene;
+	auto ids = bench::shuffled(bench::populate<4>(scene, bench::count(state)));
+
+	for (auto _ : state) {
+		float sum = 0.f;
+		for (auto id : ids) {
+			if (auto found = scene.get<Component<0>, Component<3>>(id)) {
+				sum += std::get<0>(*found).m_value + std::get<1>(*found).m_value;
+			}
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(get_many_random)->Apply(bench::sizes);
+
+static void all_of_random(benchmark::State & state) {
+	stch::Scene scene;
+	auto ids = bench::shuffled(bench::populate<2>(scene, bench::count(state)));
+
+	for (auto _ : state) {
+		std::size_t matched = 0;
+		for (auto id : ids) {
+			matched += scene.all_of<Component<0>, Component<1>>(id);
+		}
+		benchmark::DoNotOptimize(matched);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(all_of_random)->Apply(bench::sizes);
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Scene.hpp"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// distinct component types of the same shape, so that workloads only differ in
+// how many types they touch
+template <std::size_t N>
+struct Component {
+	float m_value;
+};
+
+// every random choice is seeded with this, so runs are reproducible
+inline constexpr unsigned seed = 0x5717c4;
+
+// entity counts for benchmarks that scale with the scene
+inline void sizes(benchmark::internal::Benchmark * benchmark) {
+	benchmark->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond);
+}
+
+inline std::vector<stch::EntityID> shuffled(std::vector<stch::EntityID> ids) {
+	std::shuffle(ids.begin(), ids.end(), std::mt19937{seed});
+	return ids;
+}
+
+// `count` entities holding Component<0> ... Component<K - 1>
+template <std::size_t... Is>
+std::vector<stch::EntityID> populate(stch::Scene & scene, std::size_t count, std::index_sequence<Is...>) {
+	return scene.create_n(count, Component<Is>{static_cast<float>(Is)}...);
+}
+
+template <std::size_t K>
+std::vector<stch::EntityID> populate(stch::Scene & scene, std::size_t count) {
+	return populate(scene, count, std::make_index_sequence<K>{});
+}
+
+inline std::size_t count(const benchmark::State & state) {
+	return static_cast<std::size_t>(state.range(0));
+}
+
+} // namespace bench
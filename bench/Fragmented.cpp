@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Common.hpp"
+
+using bench::Component;
+
+namespace {
+
+template <std::size_t N>
+struct Variant {
+	int m_value;
+};
+
+// entities spread over 256 archetypes: every one holds Component<0> and one of
+// the 256 subsets of Variant<0> ... Variant<7>
+template <std::size_t... Is>
+std::vector<stch::EntityID> fragment(stch::Scene & scene, std::size_t count, std::index_sequence<Is...>) {
+	auto ids = bench::populate<1>(scene, count);
+	for (std::size_t i = 0; i < ids.size(); i++) {
+		((i >> Is & 1 ? (void)scene.emplace<Variant<Is>>(ids[i], Variant<Is>{1}) : void()), ...);
+	}
+	return ids;
+}
+
+std::vector<stch::EntityID> fragment(stch::Scene & scene, std::size_t count) {
+	return fragment(scene, count, std::make_index_sequence<8>{});
+}
+
+} // namespace
+
+static void fragmented_each(benchmark::State & state) {
+	stch::Scene scene;
+	fragment(scene, bench::count(state));
+
+	for (auto _ : state) {
+		scene.each<Component<0>>([](Component<0> & component) {
+			component.m_value += 1.f;
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(fragmented_each)->Apply(bench::sizes);
+
+// only the half of the archetypes holding Variant<0>
+static void fragmented_each_filtered(benchmark::State & state) {
+	stch::Scene scene;
+	fragment(scene, bench::count(state));
+
+	for (auto _ : state) {
+		scene.each<Component<0>, const Variant<0>, stch::without<Variant<7>>>([](Component<0> & component, const Variant<0> & variant) {
+			component.m_value += static_cast<float>(variant.m_value);
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0) / 4);
+}
+BENCHMARK(fragmented_each_filtered)->Apply(bench::sizes);
+
+// structural changes that cross between many archetype pairs
+static void fragmented_emplace_erase(benchmark::State & state) {
+	stch::Scene scene;
+	auto ids = bench::shuffled(fragment(scene, bench::count(state)));
+
+	for (auto _ : state) {
+		for (auto id : ids) {
+			scene.emplace<Component<1>>(id, Component<1>{1.f});
+		}
+		for (auto id : ids) {
+			scene.erase<Component<1>>(id);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(fragmented_emplace_erase)->Apply(bench::sizes);
@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Common.hpp"
+
+#include "Stitch/CommandBuffer.hpp"
+
+namespace {
+
+struct Position { float x, y; };
+struct Velocity { float x, y; };
+struct Health { int m_points; };
+struct Burning { int m_frames; };
+
+} // namespace
+
+// Whole frames of a small simulation: movement for everyone, then 1% of the
+// entities get hit, which sets some on fire and kills and respawns others
+// through a command buffer
+static void frame(benchmark::State & state) {
+	stch::Scene scene;
+	auto ids = scene.create_n(bench::count(state), Position{0.f, 0.f}, Velocity{1.f, 0.5f}, Health{100});
+
+	std::mt19937 random{bench::seed};
+	std::uniform_int_distribution<std::size_t> pick(0, ids.size() - 1);
+	stch::CommandBuffer commands;
+	std::vector<std::pair<std::size_t, stch::EntityID>> respawned;
+	std::vector<bool> killed(ids.size());
+
+	for (auto _ : state) {
+		scene.each<Position, const Velocity>([](Position & position, const Velocity & velocity) {
+			position.x += velocity.x * 0.016f;
+			position.y += velocity.y * 0.016f;
+		});
+
+		scene.each<Health, Burning>([](Health & health, Burning & burning) {
+			health.m_points--;
+			burning.m_frames--;
+		});
+
+		for (std::size_t i = 0; i < ids.size() / 100; i++) {
+			auto index = pick(random);
+			auto id = ids[index];
+			if (killed[index]) {
+				continue; // died earlier this frame, but stays alive until the flush
+			}
+
+			auto & health = *scene.get<Health>(id);
+			health.m_points -= 25;
+
+			if (health.m_points <= 0) {
+				commands.erase(id);
+				killed[index] = true;
+				auto spawn = commands.emplace();
+				commands.emplace<Position>(spawn, Position{0.f, 0.f});
+				commands.emplace<Velocity>(spawn, Velocity{1.f, 0.5f});
+				commands.emplace<Health>(spawn, Health{100});
+				respawned.emplace_back(index, spawn);
+			} else if (auto * burning = scene.get<Burning>(id)) {
+				if (burning->m_frames <= 0) {
+					commands.erase<Burning>(id);
+				}
+			} else if (i % 4 == 0) {
+				commands.emplace<Burning>(id, Burning{30});
+			}
+		}
+
+		scene.flush(commands);
+		for (auto [index, spawn] : respawned) {
+			ids[index] = commands.resolve(spawn);
+			killed[index] = false;
+		}
+		respawned.clear();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(frame)->Arg(10'000)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Common.hpp"
+
+using bench::Component;
+
+// each over the first K of 8 components every entity holds
+template <std::size_t... Is>
+static void each(benchmark::State & state, std::index_sequence<Is...>) {
+	stch::Scene scene;
+	bench::populate<8>(scene, bench::count(state));
+
+	for (auto _ : state) {
+		scene.each<Component<Is>...>([](Component<Is> &... components) {
+			((components.m_value += 1.f), ...);
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <std::size_t K>
+static void each(benchmark::State & state) {
+	each(state, std::make_index_sequence<K>{});
+}
+BENCHMARK_TEMPLATE(each, 1)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(each, 2)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(each, 4)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(each, 8)->Apply(bench::sizes);
+
+template <std::size_t... Is>
+static void each_chunk(benchmark::State & state, std::index_sequence<Is...>) {
+	stch::Scene scene;
+	bench::populate<8>(scene, bench::count(state));
+
+	for (auto _ : state) {
+		scene.each_chunk<Component<Is>...>([](std::size_t count, Component<Is> *... columns) {
+			for (std::size_t i = 0; i < count; i++) {
+				((columns[i].m_value += 1.f), ...);
+			}
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <std::size_t K>
+static void each_chunk(benchmark::State & state) {
+	each_chunk(state, std::make_index_sequence<K>{});
+}
+BENCHMARK_TEMPLATE(each_chunk, 1)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(each_chunk, 2)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(each_chunk, 4)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(each_chunk, 8)->Apply(bench::sizes);
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "benchmark/benchmark.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Like benchmark_main, but results also go to StitchBench.json unless another
+// --benchmark_out is given, so every run leaves a machine-readable record
+int main(int argc, char ** argv) {
+	std::vector<char *> arguments(argv, argv + argc);
+
+	std::string out = "--benchmark_out=StitchBench.json";
+	std::string format = "--benchmark_out_format=json";
+	bool named = false;
+	for (int i = 1; i < argc; i++) {
+		named = named || std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+	}
+	if (!named) {
+		arguments.push_back(out.data());
+		arguments.push_back(format.data());
+	}
+
+	auto count = static_cast<int>(arguments.size());
+	benchmark::Initialize(&count, arguments.data());
+	if (benchmark::ReportUnrecognizedArguments(count, arguments.data())) {
+		return 1;
+	}
+
+	benchmark::AddCustomContext("stitch_version", STITCH_VERSION);
+#ifdef STITCH_PAD_COLUMNS
+	benchmark::AddCustomContext("stitch_pad_columns", "on");
+#else
+	benchmark::AddCustomContext("stitch_pad_columns", "off");
+#endif
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Scene.hpp"
+#include "benchmark/benchmark.h"
+
+#include <thread>
+
+namespace {
+
+struct Position { float x, y, z; };
+struct Velocity { float x, y, z; };
+
+stch::Scene & world() {
+	static stch::Scene scene;
+	static bool populated = false;
+
+	if (!populated) {
+		for (int i = 0; i < 1'000'000; i++) {
+			auto id = scene.emplace();
+			scene.emplace<Position>(id, Position{0.f, 0.f, 0.f});
+			scene.emplace<Velocity>(id, Velocity{1.f, 2.f, 3.f});
+		}
+		populated = true;
+	}
+	return scene;
+}
+
+void integrate(std::size_t count, Position * positions, const Velocity * velocities) {
+	for (std::size_t i = 0; i < count; i++) {
+		positions[i].x += velocities[i].x * 0.016f;
+		positions[i].y += velocities[i].y * 0.016f;
+		positions[i].z += velocities[i].z * 0.016f;
+	}
+}
+
+} // namespace
+
+static void each_chunk(benchmark::State & state) {
+	auto & scene = world();
+	for (auto _ : state) {
+		scene.each_chunk<Position, const Velocity>(integrate);
+	}
+	state.SetItemsProcessed(state.iterations() * 1'000'000);
+}
+BENCHMARK(each_chunk)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void par_each_chunk(benchmark::State & state) {
+	auto & scene = world();
+	stch::Workers workers{static_cast<std::size_t>(state.range(0))};
+	for (auto _ : state) {
+		scene.par_each_chunk<Position, const Velocity>(workers, integrate);
+	}
+	state.SetItemsProcessed(state.iterations() * 1'000'000);
+}
+BENCHMARK(par_each_chunk)
+	->DenseRange(1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())))
+	->ArgName("threads")
+	->UseRealTime()
+	->Unit(benchmark::kMillisecond);
@@ -0,0 +1,151 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Common.hpp"
+
+#include "Stitch/CommandBuffer.hpp"
+
+using bench::Component;
+
+static void create_erase(benchmark::State & state) {
+	stch::Scene scene;
+	std::vector<stch::EntityID> ids(bench::count(state));
+
+	for (auto _ : state) {
+		for (auto & id : ids) {
+			id = scene.emplace();
+		}
+		for (auto id : ids) {
+			scene.erase(id);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(create_erase)->Apply(bench::sizes);
+
+static void create_n_erase_n(benchmark::State & state) {
+	stch::Scene scene;
+
+	for (auto _ : state) {
+		auto ids = bench::populate<2>(scene, bench::count(state));
+		scene.erase_n(ids);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(create_n_erase_n)->Apply(bench::sizes);
+
+// spawn copies of a template entity holding four components, then erase them
+static void clone_erase_n(benchmark::State & state) {
+	stch::Scene scene;
+	auto original = bench::populate<4>(scene, 1).front();
+
+	for (auto _ : state) {
+		auto ids = scene.clone(original, bench::count(state));
+		scene.erase_n(ids);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(clone_erase_n)->Apply(bench::sizes);
+
+static void instantiate_erase_n(benchmark::State & state) {
+	stch::Scene scene;
+	stch::Prefab prefab(Component<0>{0.f}, Component<1>{1.f}, Component<2>{2.f}, Component<3>{3.f});
+
+	for (auto _ : state) {
+		auto ids = scene.instantiate(prefab, bench::count(state));
+		scene.erase_n(ids);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(instantiate_erase_n)->Apply(bench::sizes);
+
+// add K components to every entity, one emplace call each, then remove them again
+template <std::size_t... Is>
+static void emplace_erase(benchmark::State & state, std::index_sequence<Is...>) {
+	stch::Scene scene;
+	auto ids = bench::populate<0>(scene, bench::count(state));
+
+	for (auto _ : state) {
+		for (auto id : ids) {
+			(scene.emplace<Component<Is>>(id, Component<Is>{1.f}), ...);
+		}
+		for (auto id : ids) {
+			(scene.erase<Component<Is>>(id), ...);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <std::size_t K>
+static void emplace_erase(benchmark::State & state) {
+	emplace_erase(state, std::make_index_sequence<K>{});
+}
+BENCHMARK_TEMPLATE(emplace_erase, 1)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(emplace_erase, 2)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(emplace_erase, 4)->Apply(bench::sizes);
+
+// the same, with every component of an entity added and removed in one call
+template <std::size_t... Is>
+static void emplace_erase_many(benchmark::State & state, std::index_sequence<Is...>) {
+	stch::Scene scene;
+	auto ids = bench::populate<0>(scene, bench::count(state));
+
+	for (auto _ : state) {
+		for (auto id : ids) {
+			scene.emplace<Component<Is>...>(id, Component<Is>{1.f}...);
+		}
+		for (auto id : ids) {
+			scene.erase<Component<Is>...>(id);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <std::size_t K>
+static void emplace_erase_many(benchmark::State & state) {
+	emplace_erase_many(state, std::make_index_sequence<K>{});
+}
+BENCHMARK_TEMPLATE(emplace_erase_many, 2)->Apply(bench::sizes);
+BENCHMARK_TEMPLATE(emplace_erase_many, 4)->Apply(bench::sizes);
+
+static void deferred_emplace_erase(benchmark::State & state) {
+	stch::Scene scene;
+	auto ids = bench::populate<1>(scene, bench::count(state));
+	stch::CommandBuffer commands;
+
+	for (auto _ : state) {
+		for (auto id : ids) {
+			commands.emplace<Component<1>>(id, Component<1>{1.f});
+		}
+		scene.flush(commands);
+
+		for (auto id : ids) {
+			commands.erase<Component<1>>(id);
+		}
+		scene.flush(commands);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(deferred_emplace_erase)->Apply(bench::sizes);
+
+// appending rows one at a time, from an empty archetype each iteration
+static void growth(benchmark::State & state) {
+	auto storage = state.range(1) ? stch::Storage::Chunked : stch::Storage::Contiguous;
+	bool reserved = state.range(2);
+
+	for (auto _ : state) {
+		stch::Scene scene(storage);
+		if (reserved) {
+			scene.reserve<Component<0>, Component<1>>(bench::count(state));
+		}
+
+		for (std::size_t i = 0; i < bench::count(state); i++) {
+			bench::populate<2>(scene, 1);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(growth)
+	->ArgNames({"entities", "chunked", "reserved"})
+	->ArgsProduct({{10'000, 1'000'000}, {0, 1}, {0, 1}})
+	->Unit(benchmark::kMillisecond);
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Entity.hpp"
+#include "Stitch/Pool.hpp"
+#include "Stitch/Types.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace stch {
+
+// Records structural changes to apply later with Scene::flush. A buffer is not
+// synchronised: give every thread its own and flush them all at a sync point.
+// A flushed buffer can be recorded into again; placeholders then start over.
+class CommandBuffer {
+public:
+	CommandBuffer();
+	CommandBuffer(CommandBuffer && other);
+	~CommandBuffer();
+
+	CommandBuffer(const CommandBuffer &) = delete;
+	CommandBuffer & operator=(const CommandBuffer &) = delete;
+	CommandBuffer & operator=(CommandBuffer &&) = delete;
+
+	// returns a placeholder usable in later commands of this buffer
+	EntityID emplace();
+	void erase(EntityID id);
+
+	template <typename C, typename... Ps>
+	void emplace(EntityID id, Ps &&... args);
+	template <typename C>
+	void erase(EntityID id);
+
+	// real id of a placeholder, valid once this buffer has been flushed and until
+	// it is next recorded into
+	EntityID resolve(EntityID placeholder) const;
+	static bool is_placeholder(EntityID id);
+
+	bool empty() const;
+	void clear();
+
+private:
+	friend class Scene;
+
+	enum class Op {
+		Create,
+		Destroy,
+		Add,
+		Remove,
+	};
+
+	struct Command {
+		Op m_op;
+		EntityID m_entity;
+		arch::Type m_type;
+		const arch::Pool::Ops * m_ops;
+		std::byte * m_payload;
+	};
+
+	std::byte * allocate(std::size_t size, std::size_t align);
+	void release();
+	// called before recording a command: forget the placeholders of the last flush
+	void record();
+
+	std::vector<Command> m_commands;
+
+	// payload arena, blocks never move so constructed components stay put
+	std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+	std::size_t m_block_size;
+	std::size_t m_block_used;
+
+	std::uint32_t m_created;
+	std::vector<EntityID> m_resolved;
+	bool m_flushed; // m_resolved holds the placeholders of a flush
+};
+
+} // namespace stch
+
+#include "Stitch/CommandBuffer.ipp"
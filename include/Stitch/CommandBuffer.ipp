@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/CommandBuffer.hpp"
+
+#include <utility>
+
+namespace stch {
+
+template <typename C, typename... Ps>
+void CommandBuffer::emplace(EntityID id, Ps &&... args) {
+	record();
+
+	std::byte * payload = nullptr;
+	if constexpr (!is_tag_v<C>) {
+		payload = allocate(sizeof(C), alignof(C));
+		new (payload) C(std::forward<Ps>(args)...);
+	}
+
+	m_commands.push_back({Op::Add, id, arch::type_of<C>(), &arch::pool_ops<C>, payload});
+}
+
+template <typename C>
+void CommandBuffer::erase(EntityID id) {
+	record();
+	m_commands.push_back({Op::Remove, id, arch::type_of<C>(), nullptr, nullptr});
+}
+
+} // namespace stch
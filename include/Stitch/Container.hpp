@@ -3,17 +3,23 @@
 
 #pragma once
 
+#include "Stitch/Entity.hpp"
 #include "Stitch/Pool.hpp"
 #include "Stitch/Types.hpp"
 
-#include <optional>
-#include <unordered_map>
-
 namespace stch::arch {
 
+class Records;
+
 struct Container {
-	Container(const Kind & kind);
-	Container();
+	// `ops` is indexed by Type and must cover every type in `kind`
+	Container(
+		ID id,
+		const Kind & kind,
+		const std::pmr::vector<const Pool::Ops *> & ops,
+		Storage storage,
+		std::pmr::memory_resource * resource
+	);
 	Container(Container && other);
 	~Container() = default;
 
@@ -23,22 +29,54 @@ struct Container {
 
 	ID m_id;
 	Kind m_types;
+	Signature m_signature;
+	Kind m_stored; // m_types without tags, parallel to m_components
 
 	PoolInfo m_storage;
-	std::vector<Pool> m_components;
+	std::pmr::vector<Pool> m_components;
+	std::pmr::vector<EntityID> m_entities; // row -> owning entity, parallel to pools
 
-	std::pair<std::size_t, std::byte *> steal(
+	// move the entity at `row` of `from` into a new row here and return that row.
+	// components only `from` has are destroyed, those only this has are left uninitialised
+	std::size_t steal(
 		Container & from,
 		std::size_t row,
-		const std::unordered_map<Type, TypeMap> & shorthand,
-		std::optional<Type> remove,
-		struct Record * end
+		const std::pmr::vector<TypeMap> & shorthand,
+		Records & records
 	);
 
-	void erase(std::size_t row, struct Record * end);
+	void reserve(std::size_t capacity);
+	// empty, contiguous storage only: hold exactly `capacity` rows, but leave pools
+	// of raw types without a buffer, for Pool::borrow to provide one
+	void reserve_borrowed(std::size_t capacity);
+	// make room for `needed` rows, with headroom: one more chunk, or double the pools
+	void grow(std::size_t needed);
+	// drop capacity past the current size: reallocate the pools to fit, or free
+	// trailing chunks with chunked storage
+	void shrink_to_fit();
+	// number of rows from `row` on that are laid out next to each other in every pool,
+	// up to `end` (the current size by default)
+	std::size_t contiguous(std::size_t row) const;
+	std::size_t contiguous(std::size_t row, std::size_t end) const;
+	std::size_t push(EntityID id);
+	void erase(std::size_t row, Records & records);
+	// `rows` sorted and unique; destroys them and backfills from the tail in one pass
+	void erase(const std::vector<std::size_t> & rows, Records & records);
+	void vacate(std::size_t row, Records & records);
+	void clear();
+
+	// cached archetype graph links, keyed by the sorted set of types added / removed
+	struct Edge {
+		Kind m_delta;
+		Container * m_target;
+	};
+
+	static Container * follow(const std::pmr::vector<Edge> & edges, const Type * delta, std::size_t count);
+
+	std::pmr::vector<Edge> m_forward;
+	std::pmr::vector<Edge> m_backward;
 
-	std::unordered_map<Type, Container &> m_forward;
-	std::unordered_map<Type, Container &> m_backward;
+	std::size_t m_reallocations = 0; // see Stats::Counters
 };
 
 } // namespace stch::arch
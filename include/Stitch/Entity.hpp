@@ -7,6 +7,26 @@
 
 namespace stch {
 
+// low half: slot index, high half: generation of that slot
 using EntityID = uint64_t;
 
+namespace entity {
+
+// never handed out by a Scene, marks placeholder ids issued by a CommandBuffer
+inline constexpr std::uint32_t reserved_generation = 0xffffffff;
+
+constexpr std::uint32_t index(EntityID id) {
+	return static_cast<std::uint32_t>(id);
+}
+
+constexpr std::uint32_t generation(EntityID id) {
+	return static_cast<std::uint32_t>(id >> 32);
+}
+
+constexpr EntityID compose(std::uint32_t index, std::uint32_t generation) {
+	return (static_cast<EntityID>(generation) << 32) | index;
+}
+
+} // namespace entity
+
 } // namespace stch
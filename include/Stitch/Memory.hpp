@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace stch::arch {
+
+// deleter for objects placed in a memory resource
+template <typename T>
+struct Dispose {
+	std::pmr::memory_resource * m_resource;
+
+	void operator()(T * object) const {
+		object->~T();
+		m_resource->deallocate(object, sizeof(T), alignof(T));
+	}
+};
+
+template <typename T>
+using Owned = std::unique_ptr<T, Dispose<T>>;
+
+template <typename T, typename... Ps>
+Owned<T> make_owned(std::pmr::memory_resource * resource, Ps &&... args) {
+	auto * memory = resource->allocate(sizeof(T), alignof(T));
+	try {
+		return Owned<T>(new (memory) T(std::forward<Ps>(args)...), Dispose<T>{resource});
+	} catch (...) {
+		resource->deallocate(memory, sizeof(T), alignof(T));
+		throw;
+	}
+}
+
+} // namespace stch::arch
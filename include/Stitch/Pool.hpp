@@ -3,17 +3,139 @@
 
 #pragma once
 
+#include "Stitch/Memory.hpp"
+#include "Stitch/Snapshot.hpp"
+
+#include <atomic>
 #include <cstddef>
-#include <functional>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+namespace stch {
+
+// Specialise for component types that can be moved with a plain memcpy even
+// though they are not trivially copyable (e.g. types owning a heap pointer)
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+// Empty, trivially destructible components are tags: archetypes record them in
+// their type set only, without a pool or any per-row work
+template <typename T>
+struct is_tag : std::conjunction<std::is_empty<T>, std::is_trivially_destructible<T>> {};
+
+template <typename T>
+inline constexpr bool is_tag_v = is_tag<T>::value;
+
+// Specialise for components that are added and removed often: they live in a
+// per-type sparse set beside the archetypes, so toggling them is O(1) and never
+// moves the entity's other components
+template <typename T>
+struct is_sparse : std::false_type {};
+
+template <typename T>
+inline constexpr bool is_sparse_v = is_sparse<std::remove_cv_t<T>>::value;
+
+// Specialise for components whose changes systems want to pick up incrementally:
+// their pools remember, per row, the tick at which each value was added and last
+// written, which the changed<> and added<> query terms filter on. Tags have no
+// rows to stamp and cannot be filtered on
+template <typename T>
+struct is_tracked : std::false_type {};
+
+template <typename T>
+inline constexpr bool is_tracked_v = is_tracked<std::remove_cv_t<T>>::value;
+
+using Tick = std::uint64_t;
+
+// Specialise to give a component its own snapshot format (see Scene::save).
+// Trivially copyable components are otherwise stored as raw bytes, and others
+// cannot be saved without one:
+//   static void save(Writer & out, const T & component);
+//   static T load(Reader & in);
+template <typename T>
+struct serialise {};
+
+// How archetypes lay out their rows. Contiguous keeps one buffer per column and
+// doubles it when full; Chunked stores rows in fixed-size chunks holding every
+// column side by side, so growing never moves existing components
+enum class Storage {
+	Contiguous,
+	Chunked,
+};
+
+} // namespace stch
 
 namespace stch::arch {
 
+// Minimum alignment of every column; with STITCH_PAD_COLUMNS columns are also
+// padded to whole cache lines so that neighbouring columns never share one
+#ifdef STITCH_PAD_COLUMNS
+inline constexpr std::size_t column_alignment = 64;
+#else
+inline constexpr std::size_t column_alignment = 1;
+#endif
+
+inline constexpr std::size_t chunk_bits = 14;
+inline constexpr std::size_t chunk_size = std::size_t{1} << chunk_bits; // 16 KiB
+
+struct alignas(64) Chunk {
+	Chunk() {} // leave the bytes uninitialised
+
+	std::byte m_bytes[chunk_size];
+};
+
 struct PoolInfo {
 	std::size_t m_capacity;
 	std::size_t m_size;
+	std::pmr::memory_resource * m_resource; // backs every column and chunk
+
+	// chunked storage only: each chunk holds 1 << m_chunk_shift rows
+	bool m_chunked = false;
+	std::size_t m_chunk_shift = 0;
+	std::pmr::vector<Owned<Chunk>> m_chunks;
 };
 
 struct Pool {
+	// per-type operations, a null entry means the trivial (no-op / memcpy) version
+	struct Ops {
+		std::size_t m_size; // 0 for tags
+		std::size_t m_align;
+		void (*m_destruct)(std::byte *);
+		void (*m_relocate)(std::byte * from, std::byte * to);
+		bool m_sparse;
+		bool m_tracked;
+
+		// snapshots: the type is matched by name, and saved with the serialise<T>
+		// hooks if it has them, as raw bytes if m_raw is set, or not at all
+		const std::type_info * m_info;
+		void (*m_save)(Writer & out, const std::byte * element);
+		void (*m_load)(Reader & in, std::byte * to);
+		bool m_raw;
+
+		// cloning: copy constructs into uninitialised memory, null when a memcpy
+		// will do or when the type cannot be copied at all
+		void (*m_copy)(const std::byte * from, std::byte * to);
+		bool m_copyable;
+
+		void destroy(std::byte * element) const;
+		void relocate(std::byte * from, std::byte * to) const;
+		// `count` elements side by side; save throws std::invalid_argument and load
+		// std::runtime_error for types that can be neither hooked nor copied
+		void save(Writer & out, const std::byte * elements, std::size_t count) const;
+		void load(Reader & in, std::byte * to, std::size_t count) const;
+		// `count` copies of `element` side by side in uninitialised memory at `to`;
+		// both throw std::invalid_argument for types that cannot be copied
+		void fill(const std::byte * element, std::byte * to, std::size_t count) const;
+		void check_copyable() const;
+	};
+
 	Pool(Pool && other);
 	~Pool();
 
@@ -23,33 +145,60 @@ struct Pool {
 
 	template <typename T>
 	static Pool create(PoolInfo & info);
+	static Pool create(PoolInfo & info, const Ops & ops);
 
-	Pool dupe(PoolInfo & new_info) const;
 	std::byte * get(std::size_t row) const;
+
 	void erase(std::size_t row);
+	void vacate(std::size_t row);
+	// relocate the element at `row` into the uninitialised `to_row` of `to`, ticks included
+	void move(std::size_t row, Pool & to, std::size_t to_row);
+	void reallocate(std::size_t capacity);
+
+	// contiguous storage only: use `elements`, holding `m_capacity` elements and
+	// owned by someone else, as the column until it next reallocates. Null leaves
+	// the pool without any buffer, to be given one by borrow or reallocate
+	void borrow(std::byte * elements);
+	bool borrowed() const;
+
+	// change ticks, only kept for tracked types
+
+	bool tracked() const;
+	// mark rows [begin, end) as written at `tick`, and as added if `added` is set
+	void stamp(std::size_t begin, std::size_t end, Tick tick, bool added);
+	bool changed(std::size_t row, Tick since) const;
+	bool added(std::size_t row, Tick since) const;
+	// whether anything in the chunk holding `row` (the whole pool if not chunked) may
+	// have changed or been added after `since`
+	bool block_changed(std::size_t row, Tick since) const;
+	bool block_added(std::size_t row, Tick since) const;
 
 private:
 	friend struct Container;
+	friend class SparseSet;
 
-	using Destructor = std::function<void(std::byte *)>;
-	using UninitialisedMove = std::function<void(std::byte *, std::byte *)>;
-	using Swap = std::function<void(std::byte *, std::byte *)>;
-
-	Destructor m_destruct;
-	UninitialisedMove m_umove;
-	Swap m_swap;
+	Pool(PoolInfo & info, const Ops & ops);
 
-	Pool(
-		PoolInfo & info,
-		std::size_t type_size,
-		Destructor destructor,
-		UninitialisedMove umove,
-		Swap swap
-	);
+	std::size_t bytes(std::size_t capacity) const;
+	std::size_t block(std::size_t row) const;
+	// size the tick arrays for `capacity` rows
+	void track(std::size_t capacity);
+	static void raise(std::atomic<Tick> & maximum, Tick tick);
+	std::byte * allocate(std::size_t capacity) const;
+	void deallocate(std::byte * elements, std::size_t capacity) const;
 
+	const Ops * m_ops;
 	PoolInfo * m_storage;
 	std::size_t m_type_size;
-	std::byte * m_elements;
+	std::size_t m_align;
+	std::byte * m_elements;  // contiguous storage
+	bool m_borrowed;         // m_elements is not ours to deallocate
+	std::size_t m_offset;    // chunked storage, start of this column inside every chunk
+
+	std::pmr::vector<Tick> m_added;   // per row
+	std::pmr::vector<Tick> m_changed; // per row
+	std::pmr::deque<std::atomic<Tick>> m_block_added;   // per chunk, or one for the pool
+	std::pmr::deque<std::atomic<Tick>> m_block_changed; // per chunk, or one for the pool
 };
 
 } // namespace stch::arch
@@ -5,27 +5,84 @@
 
 #include "Stitch/Pool.hpp"
 
+#include <new>
+#include <utility>
+
 namespace stch::arch {
 
+template <typename T>
+void destruct(std::byte * p) {
+	std::launder(reinterpret_cast<T *>(p))->~T();
+}
+
+template <typename T>
+void relocate(std::byte * from, std::byte * to) {
+	auto * source = std::launder(reinterpret_cast<T *>(from));
+	new (to) T(std::move(*source));
+	source->~T();
+}
+
+template <typename T, typename = void>
+struct has_serialise : std::false_type {};
+
+template <typename T>
+struct has_serialise<T, std::void_t<decltype(&serialise<T>::save), decltype(&serialise<T>::load)>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool has_serialise_v = has_serialise<std::remove_cv_t<T>>::value;
+
+template <typename T>
+constexpr auto save_op() -> void (*)(Writer &, const std::byte *) {
+	if constexpr (has_serialise_v<T>) {
+		return [](Writer & out, const std::byte * element) {
+			serialise<std::remove_cv_t<T>>::save(out, *std::launder(reinterpret_cast<const T *>(element)));
+		};
+	} else {
+		return nullptr;
+	}
+}
+
+template <typename T>
+constexpr auto load_op() -> void (*)(Reader &, std::byte *) {
+	if constexpr (has_serialise_v<T>) {
+		return [](Reader & in, std::byte * to) {
+			new (to) std::remove_cv_t<T>(serialise<std::remove_cv_t<T>>::load(in));
+		};
+	} else {
+		return nullptr;
+	}
+}
+
+template <typename T>
+constexpr auto copy_op() -> void (*)(const std::byte *, std::byte *) {
+	if constexpr (std::is_trivially_copyable_v<T> || !std::is_copy_constructible_v<T>) {
+		return nullptr;
+	} else {
+		return [](const std::byte * from, std::byte * to) {
+			new (to) std::remove_cv_t<T>(*std::launder(reinterpret_cast<const T *>(from)));
+		};
+	}
+}
+
+template <typename T>
+inline constexpr Pool::Ops pool_ops{
+	is_tag_v<T> ? 0 : sizeof(T),
+	alignof(T),
+	std::is_trivially_destructible_v<T> ? nullptr : &destruct<T>,
+	is_trivially_relocatable_v<T> ? nullptr : &relocate<T>,
+	is_sparse_v<T>,
+	is_tracked_v<T>,
+	&typeid(T),
+	save_op<T>(),
+	load_op<T>(),
+	!has_serialise_v<T> && std::is_trivially_copyable_v<T>,
+	copy_op<T>(),
+	std::is_copy_constructible_v<T>
+};
+
 template <typename T>
 Pool Pool::create(PoolInfo & info) {
-	return Pool(
-		info,
-		sizeof(T),
-		[](std::byte * p) {
-			reinterpret_cast<T *>(p)->~T();
-		},
-		[](std::byte * s, std::byte * d) {
-			new (d) T(std::move(*reinterpret_cast<T *>(s)));
-		},
-		[](std::byte * a, std::byte * b) {
-			T temp(std::move(*reinterpret_cast<T *>(a)));
-			reinterpret_cast<T *>(a)->~T();
-			new (a) T(std::move(*reinterpret_cast<T *>(b)));
-			reinterpret_cast<T *>(b)->~T();
-			new (b) T(std::move(temp));
-		}
-	);
+	return Pool(info, pool_ops<T>);
 }
 
 } // namespace stch::arch
@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Pool.hpp"
+#include "Stitch/Types.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace stch {
+
+namespace arch {
+struct Container;
+}
+
+// Components to create many identical entities from, see Scene::instantiate.
+// A prefab holds one copy of each component, and remembers the archetype they
+// make up in the scene it was last instantiated in
+class Prefab {
+public:
+	template <typename... Cs>
+	explicit Prefab(const Cs &... components);
+	Prefab(Prefab && other);
+	~Prefab();
+
+	Prefab(const Prefab &) = delete;
+	Prefab & operator=(const Prefab &) = delete;
+	Prefab & operator=(Prefab &&) = delete;
+
+private:
+	friend class Scene;
+
+	struct Value {
+		arch::Type m_type;
+		const arch::Pool::Ops * m_ops;
+		std::byte * m_element; // null for tags
+	};
+
+	// add a copy of `element` as the component `type`
+	void keep(arch::Type type, const arch::Pool::Ops & ops, const std::byte * element);
+
+	std::vector<Value> m_values;
+	arch::Kind m_kind; // archetype of the values, i.e. every type but the sparse ones
+
+	// m_kind resolved in the scene layout `m_layout`, see Scene::m_layout
+	mutable arch::Container * m_target = nullptr;
+	mutable std::uint64_t m_layout = 0;
+};
+
+} // namespace stch
+
+#include "Stitch/Prefab.ipp"
@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Prefab.hpp"
+
+#include <type_traits>
+
+namespace stch {
+
+template <typename... Cs>
+Prefab::Prefab(const Cs &... components) {
+	static_assert((std::is_copy_constructible_v<Cs> && ...), "prefab components must be copyable");
+
+	m_values.reserve(sizeof...(Cs));
+	(keep(arch::type_of<Cs>(), arch::pool_ops<Cs>, reinterpret_cast<const std::byte *>(&components)), ...);
+}
+
+} // namespace stch
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Types.hpp"
+
+namespace stch {
+
+// Query terms, usable in each / each_chunk / par_each / query next to plain
+// component types. Plain types and optional<> are handed to the callback in
+// order; with<> and without<> only filter
+template <typename... Cs>
+struct with {};
+
+template <typename... Cs>
+struct without {};
+
+// handed to each as a C * that is null when missing, and to each_chunk as a
+// column pointer that is null for archetypes without C
+template <typename C>
+struct optional {};
+
+// filters on the change ticks of a tracked C (see is_tracked): rows written, or
+// added, after the `since` tick handed to the query
+template <typename C>
+struct changed {};
+
+template <typename C>
+struct added {};
+
+} // namespace stch
+
+namespace stch::arch {
+
+// column slot of filter terms, which have no column
+inline constexpr Type no_type = static_cast<Type>(-1);
+
+// how one query term matches archetypes and entities; defined in Scene.ipp
+template <typename T>
+struct Term;
+
+template <typename C, bool Added>
+struct Timed;
+
+} // namespace stch::arch
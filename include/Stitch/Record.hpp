@@ -4,6 +4,7 @@
 #pragma once
 
 #include "Stitch/Container.hpp"
+#include "Stitch/Snapshot.hpp"
 
 namespace stch::arch {
 
@@ -11,13 +12,48 @@ struct Record {
 	Record(Record && other);
 	Record & operator=(Record && other);
 	Record(Container & location, std::size_t row);
+	Record();
 	~Record() = default;
 
-	Record() = delete;
 	Record & operator=(const Record &) = delete;
 
 	Container * m_location;
 	std::size_t m_row;
 };
 
+class Records {
+public:
+	explicit Records(std::pmr::memory_resource * resource);
+
+	EntityID emplace(Container & location, std::size_t row);
+	void erase(EntityID id);
+	bool contains(EntityID id) const;
+
+	// checked: throws std::out_of_range for dead or stale ids
+	Record & at(EntityID id);
+	const Record & at(EntityID id) const;
+
+	// unchecked: only for ids known to be alive
+	Record & operator[](EntityID id);
+
+	// snapshots keep the generation of every slot and the recycling order;
+	// load leaves every slot dead until place() gives it a location again. Both
+	// throw std::runtime_error for inconsistent data: recycled slots that are out
+	// of range or repeated, or ids placed twice or also recycled
+	void save(Writer & out) const;
+	void load(Reader & in);
+	void place(EntityID id, Container & location, std::size_t row);
+	void clear();
+
+private:
+	struct Slot {
+		Record m_record;
+		std::uint32_t m_generation;
+		bool m_recyclable; // listed in m_recyclable
+	};
+
+	std::pmr::vector<Slot> m_slots;
+	std::pmr::vector<std::uint32_t> m_recyclable;
+};
+
 } // namespace stch::arch
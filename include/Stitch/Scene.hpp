@@ -3,8 +3,24 @@
 
 #pragma once
 
+#include "Stitch/CommandBuffer.hpp"
 #include "Stitch/Entity.hpp"
 #include "Stitch/Container.hpp"
+#include "Stitch/Prefab.hpp"
+#include "Stitch/Query.hpp"
+#include "Stitch/Record.hpp"
+#include "Stitch/Sparse.hpp"
+#include "Stitch/Stats.hpp"
+#include "Stitch/Trace.hpp"
+
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 
 namespace stch {
 
@@ -16,20 +32,64 @@ struct id {
 template <class T>
 using id_t = typename id<T>::type;
 
+// what Scene::compact reclaims
+struct Compaction {
+	// drop archetypes without entities, along with the graph edges leading to them
+	bool m_archetypes = true;
+	// shrink archetypes using less than this share of their capacity to fit; 0 never shrinks
+	double m_occupancy = 0.25;
+};
+
 
 class Scene {
 public:
-	Scene();
+	// component columns, chunks, sparse sets, the entity table and the archetype and
+	// query tables are drawn from `resource`, which must outlive the scene; an arena
+	// can then be released as a whole afterwards. Archetype type lists, scratch space
+	// of single calls, prefabs and command buffers use the global allocator
+	explicit Scene(
+		Storage storage = Storage::Contiguous,
+		std::pmr::memory_resource * resource = std::pmr::get_default_resource()
+	);
+	~Scene();
 
 	EntityID emplace();
 	void erase(EntityID id);
-	bool is_alive(EntityID id);
+	bool is_alive(EntityID id) const;
+
+	// create `count` entities holding copies of `components`, with one archetype lookup
+	template <typename... Cs>
+	std::vector<EntityID> create_n(std::size_t count, const Cs &... components);
+	// destroy many entities, compacting each affected archetype once
+	void erase_n(const std::vector<EntityID> & ids);
+	// destroy every entity matching the query Ts (see each)
+	template <typename... Ts>
+	void erase_all();
+	// `count` copies of the entity `id` with every component it has, copied a column
+	// at a time; throws std::invalid_argument, creating nothing, if one of its
+	// components cannot be copied
+	std::vector<EntityID> clone(EntityID id, std::size_t count = 1);
+	// `count` entities holding copies of the components of `prefab`
+	std::vector<EntityID> instantiate(const Prefab & prefab, std::size_t count = 1);
+	// prefab holding copies of every component of `id`
+	Prefab prefab(EntityID id) const;
+	// preallocate room for `capacity` entities holding exactly Cs
+	template <typename... Cs>
+	void reserve(std::size_t capacity);
 
 	template <typename C, typename... Ps>
 	C & emplace(EntityID id, Ps... args);
 	template <typename C>
 	void erase(EntityID id);
 
+	// add or remove several components with a single archetype move
+	template <typename C1, typename C2, typename... Cs>
+	std::tuple<C1 &, C2 &, Cs &...> emplace(EntityID id);
+	template <typename C1, typename C2, typename... Cs>
+	std::tuple<C1 &, C2 &, Cs &...> emplace(EntityID id, id_t<C1> c1, id_t<C2> c2, id_t<Cs>... cs);
+	template <typename C1, typename C2, typename... Cs>
+	void erase(EntityID id);
+
 	template <typename... Cs>
 	bool all_of(EntityID id) const;
 	template <typename... Cs>
@@ -42,18 +102,208 @@ public:
 	template <typename C1, typename C2, typename... Cs>
 	std::optional<std::tuple<C1 &, C2 &, Cs &...>> get(EntityID id);
 
+	// Ts are component types and query terms (with<>, without<>, optional<>)
+
+	// callback(Cs &..., Os *...) once per matching entity
+	template <typename... Ts, typename F>
+	void each(F && callback);
+	// callback(std::size_t count, Cs *..., Os *...) once per contiguous run of a matching
+	// archetype (the whole archetype, or one chunk with Storage::Chunked). A tag's
+	// pointer is the one instance every entity shares, so it must not be indexed
+	template <typename... Ts, typename F>
+	void each_chunk(F && callback);
+
+	// like each/each_chunk, split into batches of at most `batch` rows run on `workers`
+	template <typename... Ts, typename F>
+	void par_each(class Workers & workers, F && callback, std::size_t batch = 4096);
+	template <typename... Ts, typename F>
+	void par_each_chunk(class Workers & workers, F && callback, std::size_t batch = 4096);
+
+	// Change detection for tracked components (see is_tracked). Every write made
+	// through emplace, create_n, flush, mutable get and mutable query access is
+	// stamped with the current tick; changed<C> / added<C> terms pass rows stamped
+	// after `since`. A system typically keeps the tick returned by advance() and
+	// passes it as `since` on its next run
+	Tick tick() const;
+	// start a new tick, returning the one that ended
+	Tick advance();
+
+	template <typename... Ts, typename F>
+	void each(Tick since, F && callback);
+	template <typename... Ts, typename F>
+	void each_chunk(Tick since, F && callback);
+	template <typename... Ts, typename F>
+	void par_each(class Workers & workers, Tick since, F && callback, std::size_t batch = 4096);
+	template <typename... Ts, typename F>
+	void par_each_chunk(class Workers & workers, Tick since, F && callback, std::size_t batch = 4096);
+
+	// apply and empty recorded command buffers, batching migrations per target archetype
+	void flush(class CommandBuffer & commands);
+	void flush(std::vector<CommandBuffer> & commands);
+
+	// Snapshots hold every entity, with its id, and every component. Columns of
+	// trivially copyable components are written as whole blocks, others through
+	// their serialise<C> hooks; save throws std::invalid_argument for a component
+	// with neither. Types are matched by name: restore recognises the types this
+	// scene already uses and Cs. It replaces the whole scene, and throws
+	// std::runtime_error for a malformed snapshot, leaving the scene empty
+	void save(std::ostream & out) const;
+	template <typename... Cs>
+	void restore(std::istream & in);
+	template <typename... Cs>
+	void restore(const std::byte * data, std::size_t size);
+	// like restore, reading the snapshot file at `path` through a private mapping.
+	// With Storage::Contiguous, columns of trivially copyable components without
+	// hooks are used in place: pages load on first access and are copied on first
+	// write, and a column only moves to a buffer of its own once it has to grow
 	template <typename... Cs>
-	void each(const id_t<std::function<void(Cs &...)>> & callback);
+	void map(const std::string & path);
+
+	// archetypes with their entities and memory, and counters of structural work
+	Stats stats() const;
+	void reset_stats();
+	// also measure time spent moving entities between archetypes, off by default
+	// as it reads the clock twice per move
+	void time_migrations(bool enabled);
+
+	// Give back memory left behind by entities that are gone. Archetype IDs are
+	// handed out again densely, and views are rebuilt, so view iterators and
+	// ids from earlier stats() do not survive it. Capacity from reserve() goes
+	// too when it is unused
+	void compact(const Compaction & policy = {});
+
+	// persistent view over the archetypes matching Ts..., kept up to date as archetypes
+	// are created. Sparse components are not part of archetypes, so Ts must not name
+	// them; each and each_chunk check those per entity
+	template <typename... Ts>
+	class View & query();
 
 private:
 	friend class View;
+	friend class Schedule;
+	template <typename>
+	friend struct arch::Term;
+	template <typename, bool>
+	friend struct arch::Timed;
+
+	// visitor(std::size_t count, const EntityID *, std::tuple<pointers of the passed terms>)
+	// once per run of matching rows
+	template <typename... Ts, typename F>
+	void runs(Tick since, F && visitor);
+	template <typename... Ts, typename F>
+	void par_runs(Workers & workers, std::size_t batch, Tick since, F && visitor);
+	// rows [begin, end) of the `archetype`th archetype of `view`
+	template <typename... Ts, typename F, std::size_t... Is>
+	void visit(View & view, std::size_t archetype, std::size_t begin, std::size_t end, Tick since, F & visitor, std::index_sequence<Is...>);
+	// query() for any terms; views ignore sparse terms, which callers check per entity
+	template <typename... Ts>
+	View & unchecked_query();
+	// a single entity, checking every term against it
+	template <typename... Ts, typename F>
+	void probe(EntityID id, Tick since, F & visitor);
+	// callback once per row of a run, with references for components and pointers for optionals
+	template <typename Passed, typename F, typename Columns, std::size_t... Is>
+	static void rows(F & callback, std::size_t count, Columns & columns, std::index_sequence<Is...>);
+
+	// tags have no pool; every entity shares one instance of them
+	template <typename C>
+	static C * tag();
+
+	// queries touching sparse components check each entity on its own; when one of
+	// them requires a sparse component they walk the smallest such sparse set
+	template <typename... Ts>
+	static constexpr bool sparse_terms = (... || arch::Term<Ts>::sparse);
+	template <typename... Ts>
+	static constexpr bool sparse_driven = (... || arch::Term<Ts>::drives);
+	template <typename... Cs>
+	static constexpr std::size_t archetypal = (std::size_t{0} + ... + !is_sparse_v<Cs>);
+	// a component type list naming no type twice
+	template <typename C, typename... Cs>
+	static constexpr std::size_t occurrences = (std::size_t{0} + ... + std::is_same_v<std::remove_cv_t<C>, std::remove_cv_t<Cs>>);
+	template <typename... Cs>
+	static constexpr bool distinct = (... && (occurrences<Cs, Cs...> == 1));
+
+	template <typename C>
+	arch::SparseSet * sparse() const;
+	// null if some required sparse set was never created
+	template <typename... Ts>
+	arch::SparseSet * sparse_driver() const;
+	static void consider(arch::SparseSet * set, arch::SparseSet *& smallest, bool & missing);
+
+	// the component C of the entity at `record`, null if missing
+	template <typename C>
+	C * fetch(EntityID id, const arch::Record & record) const;
+	template <typename C>
+	bool has(EntityID id, const arch::Container & archetype) const;
+	// remove a sparse C from `id`; a no-op for other components
+	template <typename C>
+	void detach(EntityID id);
+	// remove every sparse component of `id`
+	void detach(EntityID id);
+
+	template <typename C>
+	void enroll();
+	void enroll(arch::Type type, const arch::Pool::Ops & ops);
+
+	// sorted types of Cs that are stored in archetypes, i.e. all but the sparse ones
+	template <typename... Cs>
+	static auto stored();
+
+	// archetype reached by adding / removing Cs, following or creating a cached edge
+	template <typename... Cs>
+	arch::Container & extend(arch::Container & from);
+	template <typename... Cs>
+	arch::Container & shrink(arch::Container & from);
+
+	// construct C in the entity's row, replacing the value if `previous` already stored one
+	template <typename C, typename... Ps>
+	C & construct(const arch::Container & previous, const arch::Record & current, Ps &&... args);
+
+	// find or create the archetype storing exactly `kind`
+	arch::Container & archetype(const arch::Kind & kind);
+	template <typename... Cs>
+	arch::Container & archetype();
+	arch::Container & add_archetype(arch::Owned<arch::Container> container);
+	// enter the archetype in m_registry and m_shorthand under its ID
+	void catalogue(const arch::Container & container);
+	// drop archetypes without entities except the empty one, then renumber the rest
+	void prune();
+	std::size_t migrate(arch::Record & record, arch::Container & target);
+	// append `count` rows for new entities with uninitialised components, returns the first row
+	std::size_t allocate(arch::Container & target, std::size_t count, std::vector<EntityID> & ids);
+	// copy `element` into the new rows [first, first + count) of the `column`th pool of `target`
+	void fill(arch::Container & target, std::size_t column, const std::byte * element, std::size_t first, std::size_t count);
+	void clear(arch::Container & container);
+	// drop every entity and component, and the mapping
+	void reset();
+	// `borrow`: the reader's buffer is m_mapping's, and may back columns in place
+	void load(Reader & in, bool borrow);
+	void apply(const std::vector<CommandBuffer *> & buffers);
+	// apply a buffered add or remove of a sparse component
+	void place(arch::SparseSet & set, EntityID id, const CommandBuffer::Command & change);
+
+	std::pmr::memory_resource * m_resource;
+	Storage m_storage;
+	arch::Owned<arch::Mapping> m_mapping; // backs borrowed columns, outlives the containers
+	arch::Records m_entities;
+
+	std::pmr::vector<arch::Owned<arch::Container>> m_containers; // indexed by arch::ID
+	std::pmr::unordered_map<arch::Kind, arch::ID, arch::KindHash> m_registry;
+	std::pmr::vector<arch::TypeMap> m_shorthand; // indexed by arch::Type
+	std::pmr::vector<const arch::Pool::Ops *> m_ops; // indexed by arch::Type
+	std::pmr::vector<arch::Owned<arch::SparseSet>> m_sparse; // indexed by arch::Type, null unless sparse
+	std::pmr::vector<arch::SparseSet *> m_sparse_sets; // the non-null entries of m_sparse
+
+	std::pmr::vector<arch::Owned<View>> m_queries;
+
+	// renewed whenever archetypes are dropped, so that prefabs look theirs up again;
+	// unique across scenes
+	std::uint64_t m_layout;
 
-	std::vector<EntityID> m_recyclable;
-	EntityID m_counter;
-	std::unordered_map<EntityID, arch::Record> m_entities;
+	Tick m_tick = 1; // 0 is older than everything, so `since` = 0 matches all rows
 
-	std::unordered_map<arch::ID, arch::Container, arch::ID::Hash> m_containers;
-	std::unordered_map<arch::Type, arch::TypeMap> m_shorthand;
+	Stats::Counters m_counters;
+	bool m_time_migrations = false;
 };
 
 }
@@ -7,187 +7,668 @@
 
 #include "Stitch/Record.hpp"
 #include "Stitch/View.hpp"
+#include "Stitch/Workers.hpp"
 
+#include <algorithm>
+#include <array>
+#include <memory>
 #include <bits/utility.h>
 #include <cassert>
 
-namespace stch {
+namespace stch::arch {
 
-template <typename C, typename... Ps>
-C &Scene::emplace(EntityID id, Ps... args) {
-	auto &current = m_entities.at(id);
-	auto target_type = std::type_index(typeid(C));
+// defaults for terms that do not look at change ticks
+struct Untimed {
+	static constexpr bool timed = false;
 
-	if (!current.m_location->m_forward.count(target_type)) {
-		// target not cached in current archetype
+	static bool skips(const Container &, std::size_t, std::size_t, Tick) {
+		return false;
+	}
 
-		auto target_kind = current.m_location->m_types;
-		target_kind.insert(
-			std::upper_bound(target_kind.begin(), target_kind.end(), target_type),
-			target_type
-		);
-		arch::ID target_kind_id{target_kind};
-
-		if (!m_containers.count(target_kind_id)) {
-			// create new archetype
-			arch::Container temp{target_kind};
-			temp.m_storage.m_size = 0;
-			temp.m_storage.m_capacity = 5;
-
-			// transpose component pools
-			size_t count = 0;
-			for (auto type : temp.m_types) {
-				if (type == target_type) {
-					// create new pool for current component
-					temp.m_components.emplace_back(arch::Pool::create<C>(temp.m_storage));
-				} else {
-					// transfer old pool layout
-					temp.m_components.emplace_back(
-						current.m_location->m_components[m_shorthand[type][current.m_location->m_id]].dupe(temp.m_storage)
-					);
-				}
+	static bool passes(const Container &, std::size_t, std::size_t, Tick) {
+		return true;
+	}
 
-				// update component lookups
-				m_shorthand[type][temp.m_id] = {count++};
-			}
+	static void touch(Container &, std::size_t, std::size_t, std::size_t, Tick) {
+	}
 
-			// generate link
-			temp.m_backward.emplace(target_type, *current.m_location);
+	static void mark(Scene &, const Record &, Tick) {
+	}
+};
+
+// plain component: required, handed over as C & (each) or C * (each_chunk)
+template <typename C>
+struct Term : Untimed {
+	using Passed = std::tuple<C>;
 
-			// add to scene
-			m_containers.emplace(temp.m_id, std::move(temp));
+	static constexpr bool sparse = is_sparse_v<C>;
+	static constexpr bool drives = sparse;
+
+	static Type column() {
+		return sparse ? no_type : type_of<C>();
+	}
+
+	static void constrain(Signature & required, Signature &) {
+		if constexpr (!sparse) {
+			required.set(type_of<C>());
 		}
+	}
 
-		// add to cache
-		current.m_location->m_forward.emplace(target_type, m_containers[target_kind_id]);
+	static void drivers(const Scene & scene, SparseSet *& smallest, bool & missing) {
+		if constexpr (sparse) {
+			Scene::consider(scene.sparse<C>(), smallest, missing);
+		}
 	}
 
-	auto &target_location = current.m_location->m_forward.at(target_type);
+	static void access(Signature & reads, Signature & writes) {
+		(std::is_const_v<C> ? reads : writes).set(type_of<C>());
+	}
 
-	arch::Record *end = nullptr;
-	for (auto &[eid, record] : m_entities) {
-		if (record.m_location == &target_location && record.m_row + 1 == current.m_location->m_storage.m_size) {
-			end = &record;
+	static std::tuple<C *> columns(Container & container, std::size_t column, std::size_t row) {
+		if constexpr (is_tag_v<C>) {
+			return {Scene::tag<C>()};
+		} else {
+			return {reinterpret_cast<C *>(container.m_components[column].get(row))};
 		}
 	}
-	auto [row, ptr] = target_location.steal(
-		*(current.m_location),
-		current.m_row,
-		m_shorthand,
-		std::nullopt,
-		end
-	);
 
-	current = arch::Record(target_location, row);
-	C *local = new (ptr) C(std::forward<Ps>(args)...);
+	static bool admits(const Scene & scene, EntityID id, const Record & record, Tick) {
+		return scene.has<C>(id, *record.m_location);
+	}
+
+	static std::tuple<C *> pointers(const Scene & scene, EntityID id, const Record & record) {
+		return {scene.fetch<C>(id, record)};
+	}
+
+	// mutable access counts as a write
+	static void touch(Container & container, std::size_t column, std::size_t begin, std::size_t end, Tick tick) {
+		if constexpr (!std::is_const_v<C> && is_tracked_v<C> && !sparse && !is_tag_v<C>) {
+			container.m_components[column].stamp(begin, end, tick, false);
+		}
+	}
+
+	// touch for a single entity reached by probing
+	static void mark(Scene & scene, const Record & record, Tick tick) {
+		if constexpr (!std::is_const_v<C> && is_tracked_v<C> && !sparse && !is_tag_v<C>) {
+			auto & container = *record.m_location;
+			touch(container, scene.m_shorthand[type_of<C>()].at(container.m_id), record.m_row, record.m_row + 1, tick);
+		}
+	}
+
+	static C & at(C * column, std::size_t row) {
+		if constexpr (is_tag_v<C>) {
+			return *column; // every row shares the one instance
+		} else {
+			return column[row];
+		}
+	}
+};
+
+template <typename... Cs>
+struct Term<with<Cs...>> : Untimed {
+	using Passed = std::tuple<>;
+
+	static constexpr bool sparse = (... || is_sparse_v<Cs>);
+	static constexpr bool drives = sparse;
+
+	static Type column() {
+		return no_type;
+	}
+
+	static void constrain(Signature & required, Signature &) {
+		(Term<Cs>::constrain(required, required), ...);
+	}
+
+	static void drivers(const Scene & scene, SparseSet *& smallest, bool & missing) {
+		(Term<Cs>::drivers(scene, smallest, missing), ...);
+	}
+
+	static void access(Signature &, Signature &) {
+	}
+
+	static std::tuple<> columns(Container &, std::size_t, std::size_t) {
+		return {};
+	}
+
+	static bool admits(const Scene & scene, EntityID id, const Record & record, Tick) {
+		return (... && scene.has<Cs>(id, *record.m_location));
+	}
+
+	static std::tuple<> pointers(const Scene &, EntityID, const Record &) {
+		return {};
+	}
+};
+
+template <typename... Cs>
+struct Term<without<Cs...>> : Untimed {
+	using Passed = std::tuple<>;
+
+	static constexpr bool sparse = (... || is_sparse_v<Cs>);
+	static constexpr bool drives = false;
+
+	static Type column() {
+		return no_type;
+	}
+
+	static void constrain(Signature &, Signature & excluded) {
+		(Term<Cs>::constrain(excluded, excluded), ...);
+	}
+
+	static void drivers(const Scene &, SparseSet *&, bool &) {
+	}
+
+	static void access(Signature &, Signature &) {
+	}
+
+	static std::tuple<> columns(Container &, std::size_t, std::size_t) {
+		return {};
+	}
+
+	static bool admits(const Scene & scene, EntityID id, const Record & record, Tick) {
+		return !(... || scene.has<Cs>(id, *record.m_location));
+	}
+
+	static std::tuple<> pointers(const Scene &, EntityID, const Record &) {
+		return {};
+	}
+};
+
+template <typename C>
+struct Term<optional<C>> : Untimed {
+	using Passed = std::tuple<optional<C>>;
+
+	static constexpr bool sparse = is_sparse_v<C>;
+	static constexpr bool drives = false;
+
+	static Type column() {
+		return Term<C>::column();
+	}
+
+	static void constrain(Signature &, Signature &) {
+	}
+
+	static void drivers(const Scene &, SparseSet *&, bool &) {
+	}
 
-	return *local;
+	static void access(Signature & reads, Signature & writes) {
+		Term<C>::access(reads, writes);
+	}
+
+	static std::tuple<C *> columns(Container & container, std::size_t column, std::size_t row) {
+		if constexpr (is_tag_v<C>) {
+			return {container.m_signature.test(type_of<C>()) ? Scene::tag<C>() : nullptr};
+		} else {
+			return {column == TypeMap::npos ? nullptr : reinterpret_cast<C *>(container.m_components[column].get(row))};
+		}
+	}
+
+	static bool admits(const Scene &, EntityID, const Record &, Tick) {
+		return true;
+	}
+
+	static std::tuple<C *> pointers(const Scene & scene, EntityID id, const Record & record) {
+		return {scene.fetch<C>(id, record)};
+	}
+
+	static C * at(C * column, std::size_t row) {
+		if constexpr (is_tag_v<C>) {
+			return column;
+		} else {
+			return column ? column + row : nullptr;
+		}
+	}
+};
+
+// changed<C> and added<C>: require C, and only pass rows whose tick is past `since`
+template <typename C, bool Added>
+struct Timed {
+	static_assert(is_tracked_v<C>, "change filters need stch::is_tracked<C>");
+	static_assert(!is_sparse_v<C>, "sparse components do not keep change ticks");
+	static_assert(!is_tag_v<C>, "tags have no pool, so no rows to keep change ticks for");
+
+	using Passed = std::tuple<>;
+
+	static constexpr bool sparse = false;
+	static constexpr bool drives = false;
+	static constexpr bool timed = true;
+
+	static Type column() {
+		return type_of<C>();
+	}
+
+	static void constrain(Signature & required, Signature &) {
+		required.set(type_of<C>());
+	}
+
+	static void drivers(const Scene &, SparseSet *&, bool &) {
+	}
+
+	// reads the change ticks of C
+	static void access(Signature & reads, Signature &) {
+		reads.set(type_of<C>());
+	}
+
+	static std::tuple<> columns(Container &, std::size_t, std::size_t) {
+		return {};
+	}
+
+	// nothing in the chunk holding `row` is recent enough
+	static bool skips(const Container & container, std::size_t column, std::size_t row, Tick since) {
+		const auto & pool = container.m_components[column];
+		return !(Added ? pool.block_added(row, since) : pool.block_changed(row, since));
+	}
+
+	static bool passes(const Container & container, std::size_t column, std::size_t row, Tick since) {
+		const auto & pool = container.m_components[column];
+		return Added ? pool.added(row, since) : pool.changed(row, since);
+	}
+
+	static void touch(Container &, std::size_t, std::size_t, std::size_t, Tick) {
+	}
+
+	static void mark(Scene &, const Record &, Tick) {
+	}
+
+	static bool admits(const Scene & scene, EntityID, const Record & record, Tick since) {
+		const auto & container = *record.m_location;
+		auto type = type_of<C>();
+		if (type >= scene.m_shorthand.size() || !scene.m_shorthand[type].contains(container.m_id)) {
+			return false;
+		}
+		return passes(container, scene.m_shorthand[type].at(container.m_id), record.m_row, since);
+	}
+
+	static std::tuple<> pointers(const Scene &, EntityID, const Record &) {
+		return {};
+	}
+};
+
+template <typename C>
+struct Term<changed<C>> : Timed<C, false> {};
+
+template <typename C>
+struct Term<added<C>> : Timed<C, true> {};
+
+} // namespace stch::arch
+
+namespace stch {
+
+template <typename C, typename... Ps>
+C &Scene::emplace(EntityID id, Ps... args) {
+	STITCH_TRACE_SCOPE("stch::Scene::emplace");
+	auto &current = m_entities.at(id);
+	auto * previous = current.m_location;
+
+	auto &target = extend<C>(*previous);
+	if (&target != previous) {
+		migrate(current, target);
+	}
+
+	return construct<C>(*previous, current, std::forward<Ps>(args)...);
+}
+
+template <typename C1, typename C2, typename... Cs>
+std::tuple<C1 &, C2 &, Cs &...> Scene::emplace(EntityID id) {
+	STITCH_TRACE_SCOPE("stch::Scene::emplace");
+	static_assert(distinct<C1, C2, Cs...>, "each component type can only be given once");
+	auto &current = m_entities.at(id);
+	auto * previous = current.m_location;
+
+	auto &target = extend<C1, C2, Cs...>(*previous);
+	if (&target != previous) {
+		migrate(current, target);
+	}
+
+	return {construct<C1>(*previous, current), construct<C2>(*previous, current), construct<Cs>(*previous, current)...};
+}
+
+template <typename C1, typename C2, typename... Cs>
+std::tuple<C1 &, C2 &, Cs &...> Scene::emplace(EntityID id, id_t<C1> c1, id_t<C2> c2, id_t<Cs>... cs) {
+	STITCH_TRACE_SCOPE("stch::Scene::emplace");
+	static_assert(distinct<C1, C2, Cs...>, "each component type can only be given once");
+	auto &current = m_entities.at(id);
+	auto * previous = current.m_location;
+
+	auto &target = extend<C1, C2, Cs...>(*previous);
+	if (&target != previous) {
+		migrate(current, target);
+	}
+
+	return {
+		construct<C1>(*previous, current, std::move(c1)),
+		construct<C2>(*previous, current, std::move(c2)),
+		construct<Cs>(*previous, current, std::move(cs))...
+	};
 }
 
 template <typename C>
 void Scene::erase(EntityID id) {
+	STITCH_TRACE_SCOPE("stch::Scene::erase");
 	auto &current = m_entities.at(id);
-	auto target_type = std::type_index(typeid(C));
 
-	if (!current.m_location->m_backward.count(target_type)) {
-		// target not cached in current archetype
+	auto &target = shrink<C>(*current.m_location);
+	if (&target != current.m_location) {
+		migrate(current, target);
+	}
 
-		auto target_kind = current.m_location->m_types;
-		target_kind.erase(std::find(target_kind.begin(), target_kind.end(), target_type));
-		arch::ID target_kind_id{target_kind};
+	detach<C>(id);
+}
 
-		if (!m_containers.count(target_kind_id)) {
-			// create new archetype
-			arch::Container temp{target_kind};
+template <typename C1, typename C2, typename... Cs>
+void Scene::erase(EntityID id) {
+	STITCH_TRACE_SCOPE("stch::Scene::erase");
+	static_assert(distinct<C1, C2, Cs...>, "each component type can only be given once");
+	auto &current = m_entities.at(id);
 
-			// transpose component pools
-			size_t count = 0;
-			for (auto type : temp.m_types) {
-				temp.m_components.emplace_back(
-					current.m_location->m_components[m_shorthand[type][current.m_location->m_id]].dupe(temp.m_storage)
-				);
+	auto &target = shrink<C1, C2, Cs...>(*current.m_location);
+	if (&target != current.m_location) {
+		migrate(current, target);
+	}
 
-				// update component lookups
-				m_shorthand[type][temp.m_id] = {count++};
-			}
+	detach<C1>(id);
+	detach<C2>(id);
+	(detach<Cs>(id), ...);
+}
+
+template <typename... Cs>
+auto Scene::stored() {
+	std::array<arch::Type, archetypal<Cs...>> types{};
+	auto * out = types.data();
+	((is_sparse_v<Cs> || (*out++ = arch::type_of<Cs>(), true)), ...);
+
+	std::sort(types.begin(), types.end());
+	return types;
+}
 
-			// generate link
-			temp.m_forward.emplace(target_type, *current.m_location);
+template <typename... Cs>
+arch::Container & Scene::extend(arch::Container & from) {
+	(enroll<Cs>(), ...);
+
+	if constexpr (archetypal<Cs...> == 0) {
+		return from; // only sparse components, which stay out of archetypes
+	}
 
-			// add to scene
-			m_containers.emplace(temp.m_id, std::move(temp));
+	auto delta = stored<Cs...>();
+
+	if (auto * cached = arch::Container::follow(from.m_forward, delta.data(), delta.size())) {
+		m_counters.m_edge_hits++;
+		return *cached;
+	}
+	m_counters.m_edge_misses++;
+
+	// target not cached in current archetype
+	auto target_kind = from.m_types;
+	arch::Kind added;
+	for (auto type : delta) {
+		auto position = std::lower_bound(target_kind.begin(), target_kind.end(), type);
+		if (position == target_kind.end() || *position != type) {
+			target_kind.insert(position, type);
+			added.push_back(type);
 		}
+	}
+	auto &target = archetype(target_kind);
 
-		// add to cache
-		current.m_location->m_backward.emplace(target_type, m_containers[target_kind_id]);
+	// add to cache
+	from.m_forward.push_back({arch::Kind(delta.begin(), delta.end()), &target});
+	if (!added.empty() && !arch::Container::follow(target.m_backward, added.data(), added.size())) {
+		target.m_backward.push_back({added, &from});
 	}
 
-	auto &target_location = current.m_location->m_backward.at(target_type);
+	return target;
+}
+
+template <typename... Cs>
+arch::Container & Scene::shrink(arch::Container & from) {
+	if constexpr (archetypal<Cs...> == 0) {
+		return from;
+	}
 
-	arch::Record *end = nullptr;
-	for (auto &[eid, record] : m_entities) {
-		if (record.m_location == &target_location && record.m_row + 1 == target_location.m_storage.m_size) {
-			end = &record;
+	auto delta = stored<Cs...>();
+
+	if (auto * cached = arch::Container::follow(from.m_backward, delta.data(), delta.size())) {
+		m_counters.m_edge_hits++;
+		return *cached;
+	}
+	m_counters.m_edge_misses++;
+
+	// target not cached in current archetype
+	auto target_kind = from.m_types;
+	arch::Kind removed;
+	for (auto type : delta) {
+		auto position = std::lower_bound(target_kind.begin(), target_kind.end(), type);
+		if (position != target_kind.end() && *position == type) {
+			target_kind.erase(position);
+			removed.push_back(type);
 		}
 	}
-	auto [row, ptr] = target_location.steal(
-		*(current.m_location),
-		current.m_row,
-		m_shorthand,
-		target_type,
-		end
-	);
+	auto &target = archetype(target_kind);
+
+	// add to cache
+	from.m_backward.push_back({arch::Kind(delta.begin(), delta.end()), &target});
+	if (!removed.empty() && !arch::Container::follow(target.m_forward, removed.data(), removed.size())) {
+		target.m_forward.push_back({removed, &from});
+	}
 
-	current = arch::Record(target_location, row);
+	return target;
+}
+
+template <typename C, typename... Ps>
+C & Scene::construct(const arch::Container & previous, const arch::Record & current, Ps &&... args) {
+	auto type = arch::type_of<C>();
+
+	if constexpr (is_sparse_v<C>) {
+		bool existed;
+		auto id = current.m_location->m_entities[current.m_row];
+		auto *ptr = m_sparse[type]->emplace(id, existed);
+
+		if constexpr (is_tag_v<C>) {
+			return *tag<C>();
+		} else {
+			if (existed) {
+				arch::destruct<C>(ptr);
+			}
+			return *new (ptr) C(std::forward<Ps>(args)...);
+		}
+	} else if constexpr (is_tag_v<C>) {
+		return *tag<C>();
+	} else {
+		auto &target = *current.m_location;
+		auto &pool = target.m_components[m_shorthand[type].at(target.m_id)];
+		auto *ptr = pool.get(current.m_row);
+
+		bool replaced = std::binary_search(previous.m_types.begin(), previous.m_types.end(), type);
+		if (replaced) {
+			// already present, replace
+			arch::destruct<C>(ptr);
+		}
+
+		pool.stamp(current.m_row, current.m_row + 1, m_tick, !replaced);
+		return *new (ptr) C(std::forward<Ps>(args)...);
+	}
 }
 
 template <typename... Cs>
-bool Scene::all_of(EntityID id) const {
-	auto has = [&](std::type_index type) {
-		const auto &archetype = *(m_entities.at(id).m_location);
+arch::Container & Scene::archetype() {
+	static_assert(distinct<Cs...>, "each component type can only be given once");
+	(enroll<Cs>(), ...);
 
-		const auto &archetypes = m_shorthand.at(type);
-		return archetypes.count(archetype.m_id);
+	auto kind = stored<Cs...>();
+	return archetype(arch::Kind(kind.begin(), kind.end()));
+}
+
+template <typename... Cs>
+std::vector<EntityID> Scene::create_n(std::size_t count, const Cs &... components) {
+	STITCH_TRACE_SCOPE("stch::Scene::create_n");
+	static_assert(distinct<Cs...>, "each component type can only be given once");
+	auto & target = archetype<Cs...>();
+
+	std::vector<EntityID> ids;
+	auto first = allocate(target, count, ids);
+
+	auto construct = [&](const auto & component) {
+		using C = std::decay_t<decltype(component)>;
+		if constexpr (is_sparse_v<C>) {
+			auto & set = *m_sparse[arch::type_of<C>()];
+			for (auto id : ids) {
+				bool existed;
+				auto * slot = set.emplace(id, existed);
+				if constexpr (!is_tag_v<C>) {
+					new (slot) C(component);
+				}
+			}
+			return;
+		} else if constexpr (is_tag_v<C>) {
+			return;
+		}
+
+		auto & pool = target.m_components[m_shorthand[arch::type_of<C>()].at(target.m_id)];
+		for (auto row = first; row < first + count;) {
+			auto run = std::min(target.contiguous(row), first + count - row);
+			std::uninitialized_fill_n(reinterpret_cast<C *>(pool.get(row)), run, component);
+			row += run;
+		}
+		pool.stamp(first, first + count, m_tick, true);
 	};
+	(construct(components), ...);
 
-	return (... && has(std::type_index(typeid(Cs))));
+	return ids;
+}
+
+template <typename... Ts>
+void Scene::erase_all() {
+	STITCH_TRACE_SCOPE("stch::Scene::erase_all");
+	if constexpr (sparse_terms<Ts...>) {
+		std::vector<EntityID> ids;
+		runs<Ts...>(0, [&](std::size_t count, const EntityID * entities, auto &) {
+			ids.insert(ids.end(), entities, entities + count);
+		});
+		erase_n(ids);
+	} else {
+		for (auto * container : unchecked_query<Ts...>().archetypes()) {
+			clear(*container);
+		}
+	}
 }
 
 template <typename... Cs>
-bool Scene::any_of(EntityID id) const {
-	auto has = [&](std::type_index type) {
-		const auto & record = m_entities.at(id);
-		const auto & archetype = *(record.m_location);
+void Scene::restore(std::istream & in) {
+	(enroll<Cs>(), ...);
 
-		const auto & archetypes = m_shorthand.at(type);
-		return archetypes.count(archetype.m_id);
-	};
+	auto bytes = arch::read_all(in);
+	Reader reader(bytes.data(), bytes.size());
+	load(reader, false);
+}
+
+template <typename... Cs>
+void Scene::restore(const std::byte * data, std::size_t size) {
+	(enroll<Cs>(), ...);
+
+	Reader reader(data, size);
+	load(reader, false);
+}
+
+template <typename... Cs>
+void Scene::map(const std::string & path) {
+	(enroll<Cs>(), ...);
+
+	auto mapping = arch::make_owned<arch::Mapping>(m_resource, path);
+	Reader reader(mapping->data(), mapping->size());
+	load(reader, true);
+
+	// load dropped any previous mapping along with the columns it backed
+	m_mapping = std::move(mapping);
+}
+
+template <typename... Cs>
+void Scene::reserve(std::size_t capacity) {
+	static_assert(distinct<Cs...>, "each component type can only be given once");
+	archetype<Cs...>().reserve(capacity);
+}
 
-	return (... || has(std::type_index(typeid(Cs))));
+template <typename C>
+void Scene::enroll() {
+	enroll(arch::type_of<C>(), arch::pool_ops<C>);
+}
+
+template <typename C>
+void Scene::detach(EntityID id) {
+	if constexpr (is_sparse_v<C>) {
+		if (auto * set = sparse<C>()) {
+			set->erase(id);
+		}
+	}
+}
+
+template <typename... Cs>
+bool Scene::all_of(EntityID id) const {
+	const auto &archetype = *(m_entities.at(id).m_location);
+	return (... && has<Cs>(id, archetype));
+}
+
+template <typename... Cs>
+bool Scene::any_of(EntityID id) const {
+	const auto &archetype = *(m_entities.at(id).m_location);
+	return (... || has<Cs>(id, archetype));
+}
+
+template <typename C>
+bool Scene::has(EntityID id, const arch::Container & archetype) const {
+	if constexpr (is_sparse_v<C>) {
+		auto * set = sparse<C>();
+		return set && set->contains(id);
+	} else {
+		return archetype.m_signature.test(arch::type_of<C>());
+	}
 }
 
 template <typename C>
 const C *Scene::get(EntityID id) const {
-	auto type = std::type_index(typeid(C));
+	return fetch<C>(id, m_entities.at(id));
+}
 
-	const auto & record = m_entities.at(id);
+template <typename C>
+C * Scene::fetch(EntityID id, const arch::Record & record) const {
+	auto type = arch::type_of<C>();
 	const auto & archetype = *(record.m_location);
 
-	auto &archetypes = m_shorthand.at(type);
-	if (archetypes.count(archetype.m_id) == 0) {
-		return nullptr;
+	if constexpr (is_sparse_v<C>) {
+		auto * set = sparse<C>();
+		if constexpr (is_tag_v<C>) {
+			return set && set->contains(id) ? tag<C>() : nullptr;
+		} else {
+			return set ? reinterpret_cast<C *>(set->get(id)) : nullptr;
+		}
+	} else if constexpr (is_tag_v<C>) {
+		return archetype.m_signature.test(type) ? tag<C>() : nullptr;
+	} else {
+		if (type >= m_shorthand.size() || !m_shorthand[type].contains(archetype.m_id)) {
+			return nullptr;
+		}
+
+		auto column = m_shorthand[type].at(archetype.m_id);
+		return reinterpret_cast<C *>(archetype.m_components[column].get(record.m_row));
 	}
+}
 
-	auto &column = archetypes.at(archetype.m_id);
-	return reinterpret_cast<const C *>(
-		archetype.m_components[column].get(record.m_row)
-	);
+template <typename C>
+arch::SparseSet * Scene::sparse() const {
+	auto type = arch::type_of<C>();
+	return type < m_sparse.size() ? m_sparse[type].get() : nullptr;
 }
 
 template <typename C>
 C * Scene::get(EntityID id) {
-	auto result = static_cast<const Scene *>(this)->get<C>(id);
-	return const_cast<C *>(result);
+	const auto & record = m_entities.at(id);
+	auto result = fetch<C>(id, record);
+
+	if constexpr (is_tracked_v<C> && !is_sparse_v<C> && !is_tag_v<C>) {
+		// mutable access counts as a write
+		if (result) {
+			arch::Term<C>::mark(*this, record, m_tick);
+		}
+	}
+
+	return result;
 }
 
 template <typename C1, typename C2, typename... Cs>
@@ -203,14 +684,221 @@ std::optional<std::tuple<C1 &, C2 &, Cs &...>> Scene::get(EntityID id) {
     return std::nullopt;
 }
 
-template <typename... Cs>
-void Scene::each(const id_t<std::function<void(Cs &...)>> & callback) {
-	View view{*this, {std::type_index(typeid(Cs))...}};
+template <typename... Ts, typename F>
+void Scene::each(F && callback) {
+	each<Ts...>(0, std::forward<F>(callback));
+}
+
+template <typename... Ts, typename F>
+void Scene::each(Tick since, F && callback) {
+	STITCH_TRACE_SCOPE("stch::Scene::each");
+	runs<Ts...>(since, [&](std::size_t count, const EntityID *, auto & columns) {
+		using Passed = decltype(std::tuple_cat(std::declval<typename arch::Term<Ts>::Passed>()...));
+		rows<Passed>(callback, count, columns, std::make_index_sequence<std::tuple_size_v<Passed>>{});
+	});
+}
+
+template <typename... Ts, typename F>
+void Scene::each_chunk(F && callback) {
+	each_chunk<Ts...>(0, std::forward<F>(callback));
+}
 
-	for (auto [container, row] : view) {
-		callback(reinterpret_cast<Cs&>(*(container.m_components.at(m_shorthand.at(std::type_index(typeid(Cs))).at(container.m_id)).get(row)))...);
+template <typename... Ts, typename F>
+void Scene::each_chunk(Tick since, F && callback) {
+	STITCH_TRACE_SCOPE("stch::Scene::each_chunk");
+	runs<Ts...>(since, [&](std::size_t count, const EntityID *, auto & columns) {
+		std::apply([&](auto *... column) { callback(count, column...); }, columns);
+	});
+}
+
+template <typename... Ts, typename F>
+void Scene::par_each(Workers & workers, F && callback, std::size_t batch) {
+	par_each<Ts...>(workers, 0, std::forward<F>(callback), batch);
+}
+
+template <typename... Ts, typename F>
+void Scene::par_each(Workers & workers, Tick since, F && callback, std::size_t batch) {
+	STITCH_TRACE_SCOPE("stch::Scene::par_each");
+	par_runs<Ts...>(workers, batch, since, [&](std::size_t count, const EntityID *, auto & columns) {
+		using Passed = decltype(std::tuple_cat(std::declval<typename arch::Term<Ts>::Passed>()...));
+		rows<Passed>(callback, count, columns, std::make_index_sequence<std::tuple_size_v<Passed>>{});
+	});
+}
+
+template <typename... Ts, typename F>
+void Scene::par_each_chunk(Workers & workers, F && callback, std::size_t batch) {
+	par_each_chunk<Ts...>(workers, 0, std::forward<F>(callback), batch);
+}
+
+template <typename... Ts, typename F>
+void Scene::par_each_chunk(Workers & workers, Tick since, F && callback, std::size_t batch) {
+	STITCH_TRACE_SCOPE("stch::Scene::par_each_chunk");
+	par_runs<Ts...>(workers, batch, since, [&](std::size_t count, const EntityID *, auto & columns) {
+		std::apply([&](auto *... column) { callback(count, column...); }, columns);
+	});
+}
+
+template <typename... Ts, typename F>
+void Scene::runs(Tick since, F && visitor) {
+	if constexpr (sparse_driven<Ts...>) {
+		if (auto * driver = sparse_driver<Ts...>()) {
+			for (std::size_t position = 0; position < driver->size(); position++) {
+				probe<Ts...>(driver->entity(position), since, visitor);
+			}
+		}
+	} else {
+		auto & view = unchecked_query<Ts...>();
+		for (std::size_t i = 0; i < view.archetypes().size(); i++) {
+			visit<Ts...>(view, i, 0, view.archetypes()[i]->m_storage.m_size, since, visitor, std::index_sequence_for<Ts...>{});
+		}
 	}
 }
 
+template <typename... Ts, typename F>
+void Scene::par_runs(Workers & workers, std::size_t batch, Tick since, F && visitor) {
+	if constexpr (sparse_driven<Ts...>) {
+		auto * driver = sparse_driver<Ts...>();
+		if (!driver) {
+			return;
+		}
+
+		auto size = driver->size();
+		workers.run((size + batch - 1) / batch, [&](std::size_t task) {
+			for (auto position = task * batch; position < std::min((task + 1) * batch, size); position++) {
+				probe<Ts...>(driver->entity(position), since, visitor);
+			}
+		});
+	} else {
+		struct Batch {
+			std::size_t m_archetype;
+			std::size_t m_begin;
+			std::size_t m_end;
+		};
+
+		// split every archetype into row ranges so that large ones spread over all workers
+		auto & view = unchecked_query<Ts...>();
+		const auto & archetypes = view.archetypes();
+		std::vector<Batch> batches;
+		for (std::size_t i = 0; i < archetypes.size(); i++) {
+			auto & container = *archetypes[i];
+			for (std::size_t begin = 0; begin < container.m_storage.m_size;) {
+				auto end = begin + std::min(batch, container.contiguous(begin));
+				batches.push_back({i, begin, end});
+				begin = end;
+			}
+		}
+
+		workers.run(batches.size(), [&](std::size_t task) {
+			const auto & current = batches[task];
+			visit<Ts...>(view, current.m_archetype, current.m_begin, current.m_end, since, visitor, std::index_sequence_for<Ts...>{});
+		});
+	}
+}
+
+template <typename... Ts, typename F, std::size_t... Is>
+void Scene::visit(View & view, std::size_t archetype, std::size_t begin, std::size_t end, Tick since, F & visitor, std::index_sequence<Is...>) {
+	auto & container = *view.archetypes()[archetype];
+
+	auto emit = [&](std::size_t row, std::size_t count) {
+		(arch::Term<Ts>::touch(container, view.column(archetype, Is), row, row + count, m_tick), ...);
+		auto found = std::tuple_cat(arch::Term<Ts>::columns(container, view.column(archetype, Is), row)...);
+		visitor(count, container.m_entities.data() + row, found);
+	};
+
+	for (auto row = begin; row < end;) {
+		if constexpr (sparse_terms<Ts...>) {
+			// the view only matched the archetype part of the query
+			probe<Ts...>(container.m_entities[row++], since, visitor);
+		} else {
+			auto count = std::min(container.contiguous(row), end - row);
+
+			if constexpr ((... || arch::Term<Ts>::timed)) {
+				// skip whole chunks with nothing recent enough, then hand over runs of passing rows
+				if (!(... || arch::Term<Ts>::skips(container, view.column(archetype, Is), row, since))) {
+					for (auto first = row; first < row + count;) {
+						auto last = first;
+						while (last < row + count && (... && arch::Term<Ts>::passes(container, view.column(archetype, Is), last, since))) {
+							last++;
+						}
+
+						if (last != first) {
+							emit(first, last - first);
+						}
+						first = last + 1;
+					}
+				}
+			} else {
+				emit(row, count);
+			}
+
+			row += count;
+		}
+	}
+}
+
+template <typename... Ts, typename F>
+void Scene::probe(EntityID id, Tick since, F & visitor) {
+	const auto & record = m_entities[id];
+	if ((arch::Term<Ts>::admits(*this, id, record, since) && ...)) {
+		(arch::Term<Ts>::mark(*this, record, m_tick), ...);
+		auto found = std::tuple_cat(arch::Term<Ts>::pointers(*this, id, record)...);
+		visitor(1, &id, found);
+	}
+}
+
+template <typename Passed, typename F, typename Columns, std::size_t... Is>
+void Scene::rows(F & callback, std::size_t count, Columns & columns, std::index_sequence<Is...>) {
+	for (std::size_t row = 0; row < count; row++) {
+		callback(arch::Term<std::tuple_element_t<Is, Passed>>::at(std::get<Is>(columns), row)...);
+	}
+}
+
+template <typename... Ts>
+arch::SparseSet * Scene::sparse_driver() const {
+	arch::SparseSet * smallest = nullptr;
+	bool missing = false;
+	(arch::Term<Ts>::drivers(*this, smallest, missing), ...);
+
+	return missing ? nullptr : smallest;
+}
+
+template <typename C>
+C * Scene::tag() {
+	static std::remove_const_t<C> instance{};
+	return &instance;
+}
+
+template <typename... Ts>
+View & Scene::query() {
+	static_assert(!sparse_terms<Ts...>, "views only match archetypes, use each for sparse components");
+	return unchecked_query<Ts...>();
+}
+
+template <typename... Ts>
+View & Scene::unchecked_query() {
+	static const std::size_t index = View::next_index();
+
+	if (m_queries.size() <= index) {
+		m_queries.resize(index + 1);
+	}
+
+	auto & view = m_queries[index];
+	if (!view) {
+		arch::Signature required;
+		arch::Signature excluded;
+		(arch::Term<Ts>::constrain(required, excluded), ...);
+
+		view = arch::make_owned<View>(
+			m_resource,
+			*this,
+			std::vector<arch::Type>{arch::Term<Ts>::column()...},
+			required,
+			excluded
+		);
+	}
+
+	return *view;
+}
+
 
 } // namespace stch
@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace stch {
+
+class Scene;
+class Workers;
+
+// Systems over one scene, run in registration order except that systems whose
+// component access does not conflict run at the same time. Access is declared
+// with the same terms as Scene::each: C is a write, const C, changed<C> and
+// added<C> are reads, and with<> / without<> access nothing.
+//
+// Systems must not change the structure of the scene while running (create or
+// erase entities, add or remove components); record those in a CommandBuffer
+// and flush it after run(). Systems sharing a stage run as tasks of `workers`,
+// so they must not use the same Workers themselves; a system alone in its stage
+// runs on the calling thread and may.
+class Schedule {
+public:
+	struct Timing {
+		std::string m_name;
+		std::chrono::nanoseconds m_last{0};
+		std::chrono::nanoseconds m_total{0};
+		std::size_t m_runs = 0;
+	};
+
+	explicit Schedule(Scene & scene);
+
+	// system calling system(Scene &), accessing only what Ts declare; returns its index
+	template <typename... Ts, typename F>
+	std::size_t add(std::string name, F && system);
+	// system calling scene.each<Ts...>(callback) / scene.each_chunk<Ts...>(callback)
+	template <typename... Ts, typename F>
+	std::size_t each(std::string name, F && callback);
+	template <typename... Ts, typename F>
+	std::size_t each_chunk(std::string name, F && callback);
+
+	// run every system once
+	void run(Workers & workers);
+
+	std::size_t size() const;
+	// groups of systems run together, in order
+	const std::vector<std::vector<std::size_t>> & stages() const;
+	// timings of every system, indexed like the return values of add
+	const std::vector<Timing> & timings() const;
+
+private:
+	struct System {
+		std::function<void(Scene &)> m_run;
+		arch::Signature m_reads;
+		arch::Signature m_writes;
+		std::size_t m_stage;
+	};
+
+	std::size_t add(std::string name, arch::Signature reads, arch::Signature writes, std::function<void(Scene &)> system);
+	static bool conflicts(const System & first, const System & second);
+	void execute(std::size_t system);
+
+	Scene & m_scene;
+	std::vector<System> m_systems;
+	std::vector<std::vector<std::size_t>> m_stages;
+	std::vector<Timing> m_timings;
+};
+
+} // namespace stch
+
+#include "Stitch/Schedule.ipp"
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Schedule.hpp"
+
+#include "Stitch/Scene.hpp"
+
+#include <utility>
+
+namespace stch {
+
+template <typename... Ts, typename F>
+std::size_t Schedule::add(std::string name, F && system) {
+	arch::Signature reads;
+	arch::Signature writes;
+	(arch::Term<Ts>::access(reads, writes), ...);
+
+	// create the view now, systems running in parallel must not add one
+	m_scene.unchecked_query<Ts...>();
+
+	return add(std::move(name), std::move(reads), std::move(writes), std::forward<F>(system));
+}
+
+template <typename... Ts, typename F>
+std::size_t Schedule::each(std::string name, F && callback) {
+	return add<Ts...>(std::move(name), [callback = std::forward<F>(callback)](Scene & scene) mutable {
+		scene.each<Ts...>(callback);
+	});
+}
+
+template <typename... Ts, typename F>
+std::size_t Schedule::each_chunk(std::string name, F && callback) {
+	return add<Ts...>(std::move(name), [callback = std::forward<F>(callback)](Scene & scene) mutable {
+		scene.each_chunk<Ts...>(callback);
+	});
+}
+
+} // namespace stch
@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace stch {
+
+// Snapshot layout version written by Scene::save; restore reads this and every
+// earlier one. Version 2 aligns column blocks to column_block bytes from the
+// start of the snapshot, so that a mapped file can back columns in place
+inline constexpr std::uint32_t snapshot_version = 2;
+inline constexpr std::size_t column_block = 64;
+
+// Output of Scene::save and of serialise<T>::save hooks. Values are written as
+// raw native-endian bytes; snapshots are meant to be read back by the same build
+class Writer {
+public:
+	explicit Writer(std::ostream & out);
+
+	void write(const void * data, std::size_t size);
+	// T must be trivially copyable
+	template <typename T>
+	void write(const T & value);
+	// pad with zeros up to a multiple of `alignment` bytes written
+	void align(std::size_t alignment);
+
+private:
+	std::ostream & m_out;
+	std::size_t m_written;
+};
+
+// Input of Scene::restore and of serialise<T>::load hooks, reading from a byte
+// buffer that outlives it. Reading past the end throws std::runtime_error
+class Reader {
+public:
+	Reader(const std::byte * data, std::size_t size);
+
+	void read(void * data, std::size_t size);
+	template <typename T>
+	T read();
+	// the next `size` bytes, in place
+	const std::byte * take(std::size_t size);
+	// skip the padding written by Writer::align
+	void align(std::size_t alignment);
+
+	std::size_t remaining() const;
+
+private:
+	const std::byte * m_data;
+	std::size_t m_size;
+	std::size_t m_position;
+};
+
+} // namespace stch
+
+namespace stch::arch {
+
+// everything left in `in`
+std::vector<std::byte> read_all(std::istream & in);
+
+// Private, writable mapping of a whole file: pages are read on first access and
+// copied on first write, which never reaches the file
+class Mapping {
+public:
+	// throws std::system_error if the file cannot be opened or mapped
+	explicit Mapping(const std::string & path);
+	~Mapping();
+
+	Mapping(const Mapping &) = delete;
+	Mapping & operator=(const Mapping &) = delete;
+
+	std::byte * data() const;
+	std::size_t size() const;
+
+private:
+	std::byte * m_data;
+	std::size_t m_size;
+};
+
+} // namespace stch::arch
+
+#include "Stitch/Snapshot.ipp"
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Snapshot.hpp"
+
+#include <type_traits>
+
+namespace stch {
+
+template <typename T>
+void Writer::write(const T & value) {
+	static_assert(std::is_trivially_copyable_v<T>);
+	write(&value, sizeof(T));
+}
+
+template <typename T>
+T Reader::read() {
+	static_assert(std::is_trivially_copyable_v<T>);
+	T value;
+	read(&value, sizeof(T));
+	return value;
+}
+
+} // namespace stch
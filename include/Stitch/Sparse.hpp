@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Entity.hpp"
+#include "Stitch/Pool.hpp"
+
+#include <memory_resource>
+
+namespace stch::arch {
+
+// components of one sparse type, packed densely and indexed by entity
+class SparseSet {
+public:
+	SparseSet(const Pool::Ops & ops, std::pmr::memory_resource * resource);
+
+	SparseSet(const SparseSet &) = delete;
+	SparseSet & operator=(const SparseSet &) = delete;
+
+	// slot holding `id`'s component; uninitialised unless `existed` is set
+	std::byte * emplace(EntityID id, bool & existed);
+	// destroys `id`'s component, if it has one
+	void erase(EntityID id);
+	// drops `id`'s slot without destroying it, for a slot emplace left uninitialised
+	void vacate(EntityID id);
+	void clear();
+
+	bool contains(EntityID id) const;
+	// null if `id` has no component here
+	std::byte * get(EntityID id) const;
+
+	std::size_t size() const;
+	EntityID entity(std::size_t position) const;
+
+private:
+	static constexpr std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+	PoolInfo m_storage;
+	Pool m_pool;
+	std::pmr::vector<EntityID> m_dense;      // position -> entity, parallel to the pool
+	std::pmr::vector<std::uint32_t> m_sparse; // entity index -> position
+};
+
+} // namespace stch::arch
@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Stitch/Types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace stch {
+
+// Snapshot of a scene's layout and of its activity counters, see Scene::stats
+struct Stats {
+	struct Column {
+		arch::Type m_type;
+		std::size_t m_bytes; // allocated, including unused capacity
+	};
+
+	struct Archetype {
+		arch::ID m_id;
+		arch::Kind m_types;
+		std::size_t m_entities;
+		std::size_t m_capacity;
+		std::size_t m_bytes;  // every column
+		std::size_t m_wasted; // part of m_bytes in rows past m_entities
+		std::vector<Column> m_columns;
+	};
+
+	// since the scene was created or Scene::reset_stats was called
+	struct Counters {
+		std::size_t m_migrations = 0;    // entities moved between archetypes
+		std::size_t m_reallocations = 0; // pools reallocated, or chunks added
+		std::size_t m_edge_hits = 0;     // archetype graph lookups answered by a cached edge
+		std::size_t m_edge_misses = 0;
+		std::chrono::nanoseconds m_steal_time{0}; // only measured with Scene::time_migrations
+	};
+
+	// share of archetype graph lookups that hit a cached edge, 0 without lookups
+	double edge_hit_rate() const;
+
+	std::vector<Archetype> m_archetypes;
+	std::size_t m_entities = 0;
+	std::size_t m_bytes = 0;
+	std::size_t m_wasted = 0;
+	Counters m_counters;
+};
+
+} // namespace stch
@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+// Trace events around structural changes and queries, for forwarding to an
+// external profiler. Only built with STITCH_TRACE defined (the CMake option of
+// the same name); otherwise every hook compiles to nothing. Names are string
+// literals such as "stch::Scene::flush", and events nest like scopes.
+#ifdef STITCH_TRACE
+
+namespace stch::trace {
+
+// set by the application, null hooks are skipped
+inline void (*on_begin)(const char * name) = nullptr;
+inline void (*on_end)(const char * name) = nullptr;
+
+class Scope {
+public:
+	explicit Scope(const char * name)
+	: m_name(name) {
+		if (on_begin) {
+			on_begin(m_name);
+		}
+	}
+
+	~Scope() {
+		if (on_end) {
+			on_end(m_name);
+		}
+	}
+
+	Scope(const Scope &) = delete;
+	Scope & operator=(const Scope &) = delete;
+
+private:
+	const char * m_name;
+};
+
+} // namespace stch::trace
+
+#define STITCH_TRACE_JOIN_(a, b) a##b
+#define STITCH_TRACE_JOIN(a, b) STITCH_TRACE_JOIN_(a, b)
+#define STITCH_TRACE_SCOPE(name) const ::stch::trace::Scope STITCH_TRACE_JOIN(stitch_trace_, __LINE__){name}
+
+#else
+
+#define STITCH_TRACE_SCOPE(name) static_cast<void>(0)
+
+#endif
@@ -4,29 +4,71 @@
 #pragma once
 
 #include <cstdint>
-#include <typeindex>
-#include <unordered_map>
+#include <memory_resource>
+#include <type_traits>
 #include <vector>
 
 namespace stch::arch {
 
-using Type = std::type_index;
-using Kind = std::vector<Type>;
+// small dense id per component type, handed out on first use
+using Type = std::uint32_t;
+using Kind = std::vector<Type>; // sorted
 
-struct ID {
-	ID(const Kind & kind);
+Type next_type();
+
+template <typename T>
+Type type_of() {
+	if constexpr (std::is_same_v<T, std::remove_cv_t<T>>) {
+		static const Type type = next_type();
+		return type;
+	} else {
+		return type_of<std::remove_cv_t<T>>();
+	}
+}
 
+// dense index of an archetype within its scene
+struct ID {
 	std::uint32_t m_value;
 
 	operator std::uint32_t() const;
 
 	bool operator==(ID other) const;
+};
 
-	struct Hash {
-		std::size_t operator()(ID value) const;
-	};
+struct KindHash {
+	std::size_t operator()(const Kind & kind) const;
 };
 
-using TypeMap = std::unordered_map<ID, std::size_t, ID::Hash>;
+// one bit per component type, for word-parallel set tests
+struct Signature {
+	Signature() = default;
+	Signature(const Kind & kind);
+
+	void set(Type type);
+	bool test(Type type) const;
+	// every type set in `other` is also set here
+	bool includes(const Signature & other) const;
+	bool intersects(const Signature & other) const;
+
+	std::vector<std::uint64_t> m_words;
+};
+
+// column of one component type inside every archetype, indexed by archetype ID
+struct TypeMap {
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	// allocator-aware, so that tables of TypeMaps share one memory resource
+	using allocator_type = std::pmr::polymorphic_allocator<std::size_t>;
+
+	TypeMap(const allocator_type & allocator = {});
+	TypeMap(const TypeMap & other, const allocator_type & allocator);
+	TypeMap(TypeMap && other, const allocator_type & allocator);
+
+	bool contains(ID id) const;
+	std::size_t at(ID id) const;
+	void assign(ID id, std::size_t column);
+
+	std::pmr::vector<std::size_t> m_columns;
+};
 
 } // namespace stch::arch
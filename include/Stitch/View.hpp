@@ -24,20 +24,47 @@ class View {
 		Iterator operator++(int);
 
 	private:
+		void skip_empty();
+
 		View & m_parent;
 		std::size_t m_archetypes_idx;
 		std::size_t m_row;
 	};
 
 public:
-	View(class Scene & scene, std::vector<std::type_index> requested);
+	// `columns` holds one type per query term, arch::no_type for terms without a column;
+	// archetypes match if they have every type in `required` and none in `excluded`
+	View(
+		class Scene & scene,
+		std::vector<arch::Type> columns,
+		arch::Signature required,
+		arch::Signature excluded
+	);
 
 	Iterator begin();
 	Iterator end();
 
+	// every matching archetype, including currently empty ones
+	const std::pmr::vector<arch::Container *> & archetypes() const;
+	// pool index of the `term`th term inside archetypes()[archetype], npos if it has no pool
+	std::size_t column(std::size_t archetype, std::size_t term) const;
+
+	// match a newly created archetype against this view
+	void include(arch::Container & container);
+	// match every archetype of the scene again, after some were dropped and renumbered
+	void rebuild();
+
+	// unique slot for each distinct query type list, used by Scene to cache views
+	static std::size_t next_index();
+
 private:
 	Scene & m_scene;
-	std::vector<arch::ID> m_archetypes;
+	std::pmr::vector<arch::Type> m_requested;
+	arch::Signature m_required;
+	arch::Signature m_excluded;
+
+	std::pmr::vector<arch::Container *> m_archetypes;
+	std::pmr::vector<std::size_t> m_columns;
 };
 
 } // namespace stch
@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stch {
+
+// Fixed-size thread pool with one task queue per participant and work stealing.
+// The thread calling run() takes part in the work, so Workers{1} runs serially.
+class Workers {
+public:
+	explicit Workers(std::size_t threads = std::thread::hardware_concurrency());
+	~Workers();
+
+	Workers(const Workers &) = delete;
+	Workers & operator=(const Workers &) = delete;
+
+	std::size_t size() const;
+
+	// call task(i) for every i in [0, count), returns once all calls finished.
+	// Once a call throws, calls not yet started are skipped, and the first
+	// exception is rethrown after the ones already running have returned
+	void run(std::size_t count, const std::function<void(std::size_t)> & task);
+
+private:
+	struct Queue {
+		std::mutex m_mutex;
+		std::size_t m_begin = 0;
+		std::size_t m_end = 0;
+	};
+
+	void loop(std::size_t self);
+	void work(std::size_t self);
+	bool pop(std::size_t self, std::size_t & task);
+	bool steal(std::size_t self, std::size_t & task);
+	// keep the first error of this run and empty every queue
+	void fail(std::exception_ptr error);
+
+	std::vector<Queue> m_queues;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	const std::function<void(std::size_t)> * m_task;
+	std::size_t m_generation;
+	std::size_t m_finished;
+	std::exception_ptr m_error;
+	bool m_stop;
+};
+
+} // namespace stch
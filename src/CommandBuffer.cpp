@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/CommandBuffer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace stch {
+
+namespace {
+
+constexpr std::size_t default_block_size = 4096;
+
+}
+
+CommandBuffer::CommandBuffer()
+: m_block_size(0)
+, m_block_used(0)
+, m_created(0)
+, m_flushed(false) {
+}
+
+CommandBuffer::CommandBuffer(CommandBuffer && other)
+: m_commands(std::move(other.m_commands))
+, m_blocks(std::move(other.m_blocks))
+, m_block_size(other.m_block_size)
+, m_block_used(other.m_block_used)
+, m_created(other.m_created)
+, m_resolved(std::move(other.m_resolved))
+, m_flushed(other.m_flushed) {
+	other.m_commands.clear();
+	other.m_blocks.clear();
+	other.m_block_size = 0;
+	other.m_block_used = 0;
+	other.m_created = 0;
+	other.m_flushed = false;
+}
+
+CommandBuffer::~CommandBuffer() {
+	clear();
+}
+
+EntityID CommandBuffer::emplace() {
+	record();
+	auto placeholder = entity::compose(m_created++, entity::reserved_generation);
+	m_commands.push_back({Op::Create, placeholder, 0, nullptr, nullptr});
+	return placeholder;
+}
+
+void CommandBuffer::erase(EntityID id) {
+	record();
+	m_commands.push_back({Op::Destroy, id, 0, nullptr, nullptr});
+}
+
+EntityID CommandBuffer::resolve(EntityID placeholder) const {
+	if (!is_placeholder(placeholder)) {
+		return placeholder;
+	}
+
+	auto index = entity::index(placeholder);
+	if (index >= m_resolved.size()) {
+		throw std::out_of_range("stch::CommandBuffer::resolve");
+	}
+	return m_resolved[index];
+}
+
+bool CommandBuffer::is_placeholder(EntityID id) {
+	return entity::generation(id) == entity::reserved_generation;
+}
+
+bool CommandBuffer::empty() const {
+	return m_commands.empty();
+}
+
+void CommandBuffer::clear() {
+	// destroy components that were never handed to a scene
+	for (auto & command : m_commands) {
+		if (command.m_op == Op::Add && command.m_payload) {
+			command.m_ops->destroy(command.m_payload);
+		}
+	}
+
+	release();
+	m_created = 0;
+	m_resolved.clear();
+	m_flushed = false;
+}
+
+void CommandBuffer::record() {
+	if (m_flushed) {
+		m_created = 0;
+		m_resolved.clear();
+		m_flushed = false;
+	}
+}
+
+std::byte * CommandBuffer::allocate(std::size_t size, std::size_t align) {
+	auto fits = [&](std::size_t used) {
+		auto * base = m_blocks.back().get();
+		auto address = reinterpret_cast<std::uintptr_t>(base) + used;
+		auto padding = (align - address % align) % align;
+		return used + padding + size <= m_block_size ? used + padding : m_block_size;
+	};
+
+	if (m_blocks.empty() || fits(m_block_used) == m_block_size) {
+		m_block_size = std::max(default_block_size, size + align);
+		m_blocks.emplace_back(new std::byte[m_block_size]);
+		m_block_used = 0;
+	}
+
+	auto offset = fits(m_block_used);
+	m_block_used = offset + size;
+	return m_blocks.back().get() + offset;
+}
+
+void CommandBuffer::release() {
+	m_commands.clear();
+	m_blocks.clear();
+	m_block_size = 0;
+	m_block_used = 0;
+}
+
+} // namespace stch
@@ -3,116 +3,295 @@
 
 #include "Stitch/Container.hpp"
 #include "Stitch/Record.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 
 namespace stch::arch {
 
-Container::Container()
-: m_id({}) {
-}
-
-Container::Container(const Kind & kind)
-: m_id(kind)
+Container::Container(
+	ID id,
+	const Kind & kind,
+	const std::pmr::vector<const Pool::Ops *> & ops,
+	Storage storage,
+	std::pmr::memory_resource * resource)
+: m_id(id)
 , m_types(kind)
-, m_storage{5, 0} {
+, m_signature(kind)
+, m_storage{5, 0, resource, false, 0, std::pmr::vector<Owned<Chunk>>(resource)}
+, m_components(resource)
+, m_entities(resource)
+, m_forward(resource)
+, m_backward(resource) {
+	for (auto type : kind) {
+		if (ops[type]->m_size) {
+			m_stored.push_back(type);
+		}
+	}
+
+	if (storage == Storage::Chunked && !m_stored.empty()) {
+		// largest power-of-two row count for which every column fits in one chunk
+		for (std::size_t shift = chunk_bits; !m_storage.m_chunked; shift--) {
+			std::size_t bytes = 0;
+			bool fits = true;
+			for (auto type : m_stored) {
+				auto align = std::max(ops[type]->m_align, column_alignment);
+				fits = fits && align <= alignof(Chunk);
+				bytes = (bytes + align - 1) / align * align + (std::size_t{1} << shift) * ops[type]->m_size;
+			}
+
+			if (fits && bytes <= chunk_size) {
+				m_storage.m_capacity = 0;
+				m_storage.m_chunked = true;
+				m_storage.m_chunk_shift = shift;
+			} else if (!fits || shift == 0) {
+				break; // components too big or over-aligned, stay contiguous
+			}
+		}
+	}
+
+	std::size_t offset = 0;
+	for (auto type : m_stored) {
+		auto & pool = m_components.emplace_back(Pool::create(m_storage, *ops[type]));
+		offset = (offset + pool.m_align - 1) / pool.m_align * pool.m_align;
+		pool.m_offset = offset;
+		offset += (std::size_t{1} << m_storage.m_chunk_shift) * pool.m_type_size;
+	}
 }
 
 Container::Container(Container && other)
 : m_id(other.m_id)
 , m_types(other.m_types)
-, m_storage(other.m_storage)
+, m_signature(other.m_signature)
+, m_stored(other.m_stored)
+, m_storage(std::move(other.m_storage))
 , m_components(std::move(other.m_components))
+, m_entities(std::move(other.m_entities))
 , m_forward(std::move(other.m_forward))
-, m_backward(std::move(other.m_backward)) {
+, m_backward(std::move(other.m_backward))
+, m_reallocations(other.m_reallocations) {
 	for (auto & pool : m_components) {
 		pool.m_storage = &m_storage;
 	}
 }
 
-void Container::erase(std::size_t row, Record * end) {
+std::size_t Container::push(EntityID id) {
+	assert(m_components.empty());
+
+	m_entities.push_back(id);
+	return m_storage.m_size++;
+}
+
+void Container::erase(std::size_t row, Records & records) {
 	for (auto &pool : m_components) {
 		pool.erase(row);
 	}
 
+	vacate(row, records);
+}
+
+void Container::erase(const std::vector<std::size_t> & rows, Records & records) {
+	for (auto & pool : m_components) {
+		if (pool.m_ops->m_destruct) {
+			for (auto row : rows) {
+				pool.m_ops->m_destruct(pool.get(row));
+			}
+		}
+	}
+
+	auto new_size = m_storage.m_size - rows.size();
+
+	// rows past the new end that are being erased themselves cannot fill a hole
+	auto tail = std::lower_bound(rows.begin(), rows.end(), new_size);
+	auto skip = tail;
+	auto survivor = new_size;
+
+	for (auto hole = rows.begin(); hole != tail; hole++) {
+		while (skip != rows.end() && *skip == survivor) {
+			skip++;
+			survivor++;
+		}
+
+		for (auto & pool : m_components) {
+			pool.move(survivor, pool, *hole);
+		}
+
+		m_entities[*hole] = m_entities[survivor];
+		records[m_entities[*hole]].m_row = *hole;
+		survivor++;
+	}
+
+	m_entities.resize(new_size);
+	m_storage.m_size = new_size;
+}
+
+void Container::clear() {
+	for (auto & pool : m_components) {
+		if (pool.m_ops->m_destruct) {
+			for (std::size_t row = 0; row < m_storage.m_size; row++) {
+				pool.m_ops->m_destruct(pool.get(row));
+			}
+		}
+	}
+
+	m_entities.clear();
+	m_storage.m_size = 0;
+}
+
+void Container::vacate(std::size_t row, Records & records) {
 	if (m_storage.m_size > row + 1) { // swapped
 
-		// update record of row `storage.size` to `row`
-		assert(end);
-		assert(end->m_location == this);
-		assert(end->m_row == m_storage.m_size);
-		end->m_row = row;
+		// update record of the entity that was moved from the last row into `row`
+		m_entities[row] = m_entities.back();
+
+		auto & moved = records[m_entities[row]];
+		assert(moved.m_location == this);
+		assert(moved.m_row + 1 == m_storage.m_size);
+		moved.m_row = row;
 	}
+	m_entities.pop_back();
 	m_storage.m_size--;
-
 }
 
-std::pair<std::size_t, std::byte *> Container::steal(
+std::size_t Container::steal(
 	Container & from,
 	std::size_t row,
-	const std::unordered_map<Type, TypeMap> & shorthand,
-	std::optional<Type> remove,
-	Record * end) {
-	std::size_t target_row = 0;
-	if (m_components.size()) {
-		// current is non-empty
-
-		if (m_storage.m_capacity == m_storage.m_size) {
-			// ran out of slots in pools
-
-			for (auto & pool : m_components) { // each pool
-				auto * temp = new std::byte[m_storage.m_capacity * 2 * pool.m_type_size];
-				// double pool capacity
-
-				for (std::size_t i = 0; i < m_storage.m_size; i++) {
-					// move all existing components to temporary
-					auto *old = pool.get(i);
-					auto *dest = temp + i * pool.m_type_size;
-					pool.m_umove(old, dest);
-					pool.m_destruct(old);
-				}
-
-				// replace old slots
-				delete[] pool.m_elements;
-				pool.m_elements = temp;
-			}
+	const std::pmr::vector<TypeMap> & shorthand,
+	Records & records) {
+	grow(m_storage.m_size + 1);
+
+	// pick next row
+	std::size_t target_row = m_storage.m_size;
+
+	assert(from.m_storage.m_size);
+
+	for (std::size_t i = 0; i < from.m_stored.size(); i++) { // each pool the source has
+		auto &f_pool = from.m_components[i];
+		const auto &columns = shorthand[from.m_stored[i]];
+
+		if (columns.contains(m_id)) {
+			// steal from source
+			auto &pool = m_components[columns.at(m_id)];
+
+			assert(f_pool.m_type_size == pool.m_type_size);
 
-			m_storage.m_capacity *= 2;
+			f_pool.move(row, pool, target_row);
+			f_pool.vacate(row);
+		} else {
+			// is removed item
+			f_pool.erase(row);
 		}
+	}
+
+	m_entities.push_back(from.m_entities[row]);
+	m_storage.m_size++;
+
+	from.vacate(row, records);
+
+	return target_row;
+}
 
-		// pick next row
-		target_row = m_storage.m_size;
+Container * Container::follow(const std::pmr::vector<Edge> & edges, const Type * delta, std::size_t count) {
+	for (auto & edge : edges) {
+		if (std::equal(edge.m_delta.begin(), edge.m_delta.end(), delta, delta + count)) {
+			return edge.m_target;
+		}
 	}
 
-	std::pair<size_t, std::byte*> ret{target_row, nullptr};
+	return nullptr;
+}
 
-	assert(!from.m_types.size() || from.m_storage.m_size);
+void Container::reserve(std::size_t capacity) {
+	if (capacity <= m_storage.m_capacity) {
+		return;
+	}
 
-	for (std::size_t i = 0; i < m_types.size(); i++) { // each type we do have
-		if (shorthand.at(m_types[i]).count(from.m_id)) {
-			// steal from source
-			auto &pool = m_components[i];
-			const auto &column = shorthand.at(m_types[i]).at(from.m_id);
-			auto &f_pool = from.m_components[column];
+	if (m_storage.m_chunked) {
+		// existing chunks stay where they are
+		while (m_storage.m_capacity < capacity) {
+			m_storage.m_chunks.push_back(make_owned<Chunk>(m_storage.m_resource));
+			m_storage.m_capacity += std::size_t{1} << m_storage.m_chunk_shift;
+			m_reallocations++;
+		}
 
-			assert(f_pool.m_type_size == pool.m_type_size);
+		for (auto & pool : m_components) {
+			pool.track(m_storage.m_capacity);
+		}
+		return;
+	}
+
+	for (auto & pool : m_components) {
+		pool.reallocate(capacity);
+		m_reallocations++;
+	}
+
+	m_storage.m_capacity = capacity;
+}
 
-			// initialise local from source
-			pool.m_umove(f_pool.get(row), pool.get(target_row));
-			// f_pool.erase(row);
+void Container::reserve_borrowed(std::size_t capacity) {
+	assert(!m_storage.m_chunked && m_storage.m_size == 0);
+
+	for (auto & pool : m_components) {
+		if (pool.m_ops->m_raw) {
+			pool.borrow(nullptr);
+			pool.track(capacity);
 		} else {
-			// is new item
-			auto &pool = m_components[i];
+			pool.reallocate(capacity);
+			m_reallocations++;
+		}
+	}
+
+	m_storage.m_capacity = capacity;
+}
+
+void Container::grow(std::size_t needed) {
+	if (needed <= m_storage.m_capacity) {
+		return;
+	}
+
+	reserve(m_storage.m_chunked ? needed : std::max(needed, m_storage.m_capacity * 2));
+}
+
+void Container::shrink_to_fit() {
+	m_entities.shrink_to_fit();
+
+	if (m_storage.m_chunked) {
+		auto rows = std::size_t{1} << m_storage.m_chunk_shift;
+		auto chunks = (m_storage.m_size + rows - 1) / rows;
 
-			assert(!remove);
+		m_storage.m_chunks.erase(m_storage.m_chunks.begin() + static_cast<std::ptrdiff_t>(chunks), m_storage.m_chunks.end());
+		m_storage.m_chunks.shrink_to_fit();
+		m_storage.m_capacity = chunks * rows;
 
-			ret.second = pool.get(target_row);
+		for (auto & pool : m_components) {
+			pool.track(m_storage.m_capacity);
 		}
+		return;
+	}
+
+	if (m_storage.m_size == m_storage.m_capacity) {
+		return;
+	}
+
+	for (auto & pool : m_components) {
+		pool.reallocate(m_storage.m_size);
+		m_reallocations++;
 	}
-	m_storage.m_size++;
 
-	from.erase(row, end);
+	m_storage.m_capacity = m_storage.m_size;
+}
+
+std::size_t Container::contiguous(std::size_t row) const {
+	return contiguous(row, m_storage.m_size);
+}
+
+std::size_t Container::contiguous(std::size_t row, std::size_t end) const {
+	if (!m_storage.m_chunked) {
+		return end - row;
+	}
 
-	return ret;
+	auto chunk_end = ((row >> m_storage.m_chunk_shift) + 1) << m_storage.m_chunk_shift;
+	return std::min(chunk_end, end) - row;
 }
 
 } // namespace stch::arch
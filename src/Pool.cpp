@@ -3,59 +3,284 @@
 
 #include "Stitch/Pool.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
 namespace stch::arch {
 
 Pool::Pool(
 	PoolInfo & info,
-	std::size_t type_size,
-	Destructor destructor,
-	UninitialisedMove umove,
-	Swap swap)
-: m_destruct(destructor)
-, m_umove(umove)
-, m_swap(swap)
+	const Ops & ops)
+: m_ops(&ops)
 , m_storage(&info)
-, m_type_size(type_size)
-, m_elements(new std::byte[m_type_size * m_storage->m_capacity]) {
+, m_type_size(ops.m_size)
+, m_align(std::max(ops.m_align, column_alignment))
+, m_elements(info.m_chunked ? nullptr : allocate(info.m_capacity))
+, m_borrowed(false)
+, m_offset(0)
+, m_added(info.m_resource)
+, m_changed(info.m_resource)
+, m_block_added(info.m_resource)
+, m_block_changed(info.m_resource) {
+	track(info.m_capacity);
 }
 
 Pool::Pool(Pool && other)
-: m_destruct(other.m_destruct)
-, m_umove(other.m_umove)
-, m_swap(other.m_swap)
+: m_ops(other.m_ops)
 , m_storage(other.m_storage)
 , m_type_size(other.m_type_size)
-, m_elements(other.m_elements) {
+, m_align(other.m_align)
+, m_elements(other.m_elements)
+, m_borrowed(other.m_borrowed)
+, m_offset(other.m_offset)
+, m_added(std::move(other.m_added))
+, m_changed(std::move(other.m_changed))
+, m_block_added(std::move(other.m_block_added))
+, m_block_changed(std::move(other.m_block_changed)) {
+	other.m_ops = nullptr;
 	other.m_elements = nullptr;
 }
 
+void Pool::Ops::destroy(std::byte * element) const {
+	if (m_destruct) {
+		m_destruct(element);
+	}
+}
+
+void Pool::Ops::relocate(std::byte * from, std::byte * to) const {
+	if (m_relocate) {
+		m_relocate(from, to);
+	} else {
+		std::memcpy(to, from, m_size);
+	}
+}
+
+void Pool::Ops::save(Writer & out, const std::byte * elements, std::size_t count) const {
+	if (m_save) {
+		for (std::size_t i = 0; i < count; i++) {
+			m_save(out, elements + i * m_size);
+		}
+	} else if (m_raw) {
+		out.write(elements, count * m_size);
+	} else {
+		throw std::invalid_argument(std::string("stch: no serialise hook for ") + m_info->name());
+	}
+}
+
+void Pool::Ops::load(Reader & in, std::byte * to, std::size_t count) const {
+	if (m_load) {
+		for (std::size_t i = 0; i < count; i++) {
+			m_load(in, to + i * m_size);
+		}
+	} else if (m_raw) {
+		in.read(to, count * m_size);
+	} else {
+		throw std::runtime_error(std::string("stch: no serialise hook for ") + m_info->name());
+	}
+}
+
+void Pool::Ops::fill(const std::byte * element, std::byte * to, std::size_t count) const {
+	check_copyable();
+	if (!m_size) {
+		return; // tags hold nothing
+	}
+
+	if (m_copy) {
+		for (std::size_t i = 0; i < count; i++) {
+			m_copy(element, to + i * m_size);
+		}
+		return;
+	}
+
+	if (count) {
+		// copy what is already filled in, doubling it each time
+		std::memcpy(to, element, m_size);
+		for (std::size_t filled = 1; filled < count;) {
+			auto run = std::min(filled, count - filled);
+			std::memcpy(to + filled * m_size, to, run * m_size);
+			filled += run;
+		}
+	}
+}
+
+void Pool::Ops::check_copyable() const {
+	if (!m_copyable) {
+		throw std::invalid_argument(std::string("stch: cannot copy ") + m_info->name());
+	}
+}
+
 Pool::~Pool() {
-	for (std::size_t i = 0; i < m_storage->m_size; i++) {
-		m_destruct(get(i));
+	// moved-from pools have no ops and own nothing
+	if (m_ops && m_ops->m_destruct) {
+		for (std::size_t i = 0; i < m_storage->m_size; i++) {
+			m_ops->m_destruct(get(i));
+		}
 	}
 
-	delete[] m_elements;
+	if (!m_borrowed) {
+		deallocate(m_elements, m_storage->m_capacity);
+	}
 	m_elements = nullptr;
 }
 
-Pool Pool::dupe(PoolInfo & new_info) const {
-	return Pool(new_info, m_type_size, m_destruct, m_umove, m_swap);
+Pool Pool::create(PoolInfo & info, const Ops & ops) {
+	return Pool(info, ops);
 }
 
 std::byte * Pool::get(std::size_t row) const {
+	if (m_storage->m_chunked) {
+		auto shift = m_storage->m_chunk_shift;
+		auto & chunk = *m_storage->m_chunks[row >> shift];
+		return chunk.m_bytes + m_offset + (row & ((std::size_t{1} << shift) - 1)) * m_type_size;
+	}
+
 	return m_elements + row * m_type_size;
 }
 
 void Pool::erase(std::size_t row) {
-	auto * target = get(row);
-	auto * end = target;
+	m_ops->destroy(get(row));
+	vacate(row);
+}
 
+void Pool::vacate(std::size_t row) {
+	// fill the hole at `row` with the last element
 	if (m_storage->m_size > row + 1) {
-		m_swap(get(row), get(m_storage->m_size - 1));
-		end = get(m_storage->m_size - 1);
+		move(m_storage->m_size - 1, *this, row);
+	}
+}
+
+void Pool::move(std::size_t row, Pool & to, std::size_t to_row) {
+	m_ops->relocate(get(row), to.get(to_row));
+
+	if (tracked()) {
+		to.m_added[to_row] = m_added[row];
+		to.m_changed[to_row] = m_changed[row];
+		raise(to.m_block_added[to.block(to_row)], m_added[row]);
+		raise(to.m_block_changed[to.block(to_row)], m_changed[row]);
+	}
+}
+
+void Pool::reallocate(std::size_t capacity) {
+	auto * temp = allocate(capacity);
+
+	if (m_ops->m_relocate) {
+		for (std::size_t i = 0; i < m_storage->m_size; i++) {
+			m_ops->m_relocate(get(i), temp + i * m_type_size);
+		}
+	} else if (m_storage->m_size) {
+		std::memcpy(temp, m_elements, m_storage->m_size * m_type_size);
 	}
 
-	m_destruct(end);
+	// replace old slots
+	if (!m_borrowed) {
+		deallocate(m_elements, m_storage->m_capacity);
+	}
+	m_elements = temp;
+	m_borrowed = false;
+
+	track(capacity);
+}
+
+void Pool::borrow(std::byte * elements) {
+	if (!m_borrowed) {
+		deallocate(m_elements, m_storage->m_capacity);
+	}
+	m_elements = elements;
+	m_borrowed = true;
+}
+
+bool Pool::borrowed() const {
+	return m_borrowed;
+}
+
+bool Pool::tracked() const {
+	return m_ops->m_tracked;
+}
+
+void Pool::stamp(std::size_t begin, std::size_t end, Tick tick, bool added) {
+	if (!tracked() || begin == end) {
+		return;
+	}
+
+	std::fill(m_changed.data() + begin, m_changed.data() + end, tick);
+	if (added) {
+		std::fill(m_added.data() + begin, m_added.data() + end, tick);
+	}
+
+	for (auto i = block(begin); i <= block(end - 1); i++) {
+		raise(m_block_changed[i], tick);
+		if (added) {
+			raise(m_block_added[i], tick);
+		}
+	}
+}
+
+bool Pool::changed(std::size_t row, Tick since) const {
+	return m_changed[row] > since;
+}
+
+bool Pool::added(std::size_t row, Tick since) const {
+	return m_added[row] > since;
+}
+
+bool Pool::block_changed(std::size_t row, Tick since) const {
+	return m_block_changed[block(row)].load(std::memory_order_relaxed) > since;
+}
+
+bool Pool::block_added(std::size_t row, Tick since) const {
+	return m_block_added[block(row)].load(std::memory_order_relaxed) > since;
+}
+
+std::size_t Pool::block(std::size_t row) const {
+	return m_storage->m_chunked ? row >> m_storage->m_chunk_shift : 0;
+}
+
+void Pool::track(std::size_t capacity) {
+	if (!tracked()) {
+		return;
+	}
+
+	bool shrinking = capacity < m_added.size();
+	m_added.resize(capacity, 0);
+	m_changed.resize(capacity, 0);
+	if (shrinking) {
+		m_added.shrink_to_fit();
+		m_changed.shrink_to_fit();
+	}
+
+	auto blocks = m_storage->m_chunked ? m_storage->m_chunks.size() : 1;
+	while (m_block_added.size() < blocks) {
+		m_block_added.emplace_back(0);
+		m_block_changed.emplace_back(0);
+	}
+	while (m_block_added.size() > blocks) {
+		m_block_added.pop_back();
+		m_block_changed.pop_back();
+	}
+}
+
+void Pool::raise(std::atomic<Tick> & maximum, Tick tick) {
+	// parallel queries may stamp rows of the same chunk at once
+	auto current = maximum.load(std::memory_order_relaxed);
+	while (current < tick && !maximum.compare_exchange_weak(current, tick, std::memory_order_relaxed)) {
+	}
+}
+
+std::size_t Pool::bytes(std::size_t capacity) const {
+	// round up so that the column ends on an alignment boundary
+	return (capacity * m_type_size + m_align - 1) / m_align * m_align;
+}
+
+std::byte * Pool::allocate(std::size_t capacity) const {
+	return static_cast<std::byte *>(m_storage->m_resource->allocate(bytes(capacity), m_align));
+}
+
+void Pool::deallocate(std::byte * elements, std::size_t capacity) const {
+	if (elements) {
+		m_storage->m_resource->deallocate(elements, bytes(capacity), m_align);
+	}
 }
 
 } // namespace stch::arch
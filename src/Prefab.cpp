@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Prefab.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace stch {
+
+Prefab::Prefab(Prefab && other)
+: m_values(std::move(other.m_values))
+, m_kind(std::move(other.m_kind))
+, m_target(other.m_target)
+, m_layout(other.m_layout) {
+	other.m_values.clear();
+}
+
+Prefab::~Prefab() {
+	for (auto & value : m_values) {
+		if (value.m_element) {
+			value.m_ops->destroy(value.m_element);
+			::operator delete(value.m_element, std::align_val_t{value.m_ops->m_align});
+		}
+	}
+}
+
+void Prefab::keep(arch::Type type, const arch::Pool::Ops & ops, const std::byte * element) {
+	std::byte * copy = nullptr;
+	if (ops.m_size) {
+		copy = static_cast<std::byte *>(::operator new(ops.m_size, std::align_val_t{ops.m_align}));
+		try {
+			ops.fill(element, copy, 1);
+		} catch (...) {
+			::operator delete(copy, std::align_val_t{ops.m_align});
+			throw;
+		}
+	}
+	m_values.push_back({type, &ops, copy});
+
+	if (!ops.m_sparse) {
+		m_kind.insert(std::upper_bound(m_kind.begin(), m_kind.end(), type), type);
+	}
+}
+
+} // namespace stch
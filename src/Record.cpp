@@ -3,6 +3,11 @@
 
 #include "Stitch/Record.hpp"
 
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
 namespace stch::arch {
 
 Record::Record(
@@ -12,6 +17,11 @@ Record::Record(
 , m_row(row) {
 }
 
+Record::Record()
+: m_location(nullptr)
+, m_row(0) {
+}
+
 Record::Record(Record && other)
 : m_location(other.m_location), m_row(other.m_row) {
 }
@@ -22,4 +32,132 @@ Record & Record::operator=(Record && other) {
 	return *this;
 }
 
+Records::Records(std::pmr::memory_resource * resource)
+: m_slots(resource)
+, m_recyclable(resource) {
+}
+
+EntityID Records::emplace(Container & location, std::size_t row) {
+	if (m_recyclable.size()) {
+		auto index = m_recyclable.back();
+		m_recyclable.pop_back();
+
+		auto & slot = m_slots[index];
+		slot.m_record = Record(location, row);
+		slot.m_recyclable = false;
+		return entity::compose(index, slot.m_generation);
+	}
+
+	assert(m_slots.size() < std::numeric_limits<std::uint32_t>::max());
+	auto index = static_cast<std::uint32_t>(m_slots.size());
+	m_slots.push_back({Record(location, row), 0, false});
+	return entity::compose(index, 0);
+}
+
+void Records::erase(EntityID id) {
+	assert(contains(id));
+
+	// bump generation so that outstanding handles go stale
+	auto & slot = m_slots[entity::index(id)];
+	slot.m_record = Record();
+	if (++slot.m_generation == entity::reserved_generation) {
+		slot.m_generation = 0;
+	}
+	slot.m_recyclable = true;
+	m_recyclable.push_back(entity::index(id));
+}
+
+bool Records::contains(EntityID id) const {
+	auto index = entity::index(id);
+	return (
+		index < m_slots.size() &&
+		m_slots[index].m_generation == entity::generation(id) &&
+		m_slots[index].m_record.m_location
+	);
+}
+
+Record & Records::at(EntityID id) {
+	if (!contains(id)) {
+		throw std::out_of_range("stch::arch::Records::at");
+	}
+	return m_slots[entity::index(id)].m_record;
+}
+
+const Record & Records::at(EntityID id) const {
+	if (!contains(id)) {
+		throw std::out_of_range("stch::arch::Records::at");
+	}
+	return m_slots[entity::index(id)].m_record;
+}
+
+Record & Records::operator[](EntityID id) {
+	assert(contains(id));
+	return m_slots[entity::index(id)].m_record;
+}
+
+void Records::save(Writer & out) const {
+	std::vector<std::uint32_t> generations(m_slots.size());
+	for (std::size_t i = 0; i < m_slots.size(); i++) {
+		generations[i] = m_slots[i].m_generation;
+	}
+
+	out.write(static_cast<std::uint64_t>(generations.size()));
+	out.write(generations.data(), generations.size() * sizeof(std::uint32_t));
+	out.write(static_cast<std::uint64_t>(m_recyclable.size()));
+	out.write(m_recyclable.data(), m_recyclable.size() * sizeof(std::uint32_t));
+}
+
+void Records::load(Reader & in) {
+	// checked before multiplying, so that huge counts cannot wrap around
+	auto count = [&]() {
+		auto elements = in.read<std::uint64_t>();
+		if (elements > in.remaining() / sizeof(std::uint32_t)) {
+			throw std::runtime_error("stch::Reader: truncated snapshot");
+		}
+		return static_cast<std::size_t>(elements);
+	};
+
+	auto slots = count();
+	auto * generations = in.take(slots * sizeof(std::uint32_t));
+
+	m_slots.clear();
+	m_slots.resize(slots);
+	for (std::size_t i = 0; i < slots; i++) {
+		std::memcpy(&m_slots[i].m_generation, generations + i * sizeof(std::uint32_t), sizeof(std::uint32_t));
+		m_slots[i].m_recyclable = false;
+	}
+
+	auto recyclable = count();
+	auto * indices = in.take(recyclable * sizeof(std::uint32_t));
+	m_recyclable.resize(recyclable);
+	if (recyclable) {
+		std::memcpy(m_recyclable.data(), indices, recyclable * sizeof(std::uint32_t));
+	}
+
+	for (auto index : m_recyclable) {
+		if (index >= slots || m_slots[index].m_recyclable) {
+			throw std::runtime_error("stch::arch::Records::load: corrupt recycle list in snapshot");
+		}
+		m_slots[index].m_recyclable = true;
+	}
+}
+
+void Records::place(EntityID id, Container & location, std::size_t row) {
+	auto index = entity::index(id);
+	if (index >= m_slots.size() || m_slots[index].m_generation != entity::generation(id)) {
+		throw std::runtime_error("stch::arch::Records::place: stale id in snapshot");
+	}
+
+	auto & slot = m_slots[index];
+	if (slot.m_recyclable || slot.m_record.m_location) {
+		throw std::runtime_error("stch::arch::Records::place: id used twice in snapshot");
+	}
+	slot.m_record = Record(location, row);
+}
+
+void Records::clear() {
+	m_slots.clear();
+	m_recyclable.clear();
+}
+
 }
@@ -3,56 +3,873 @@
 
 #include "Stitch/Scene.hpp"
 
-#include <limits>
-#include <cassert>
+#include "Stitch/View.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 namespace stch {
 
-Scene::Scene() : m_counter(0) {
-	arch::Kind empty;
-	arch::ID id{empty};
+namespace {
+
+constexpr char snapshot_magic[4] = {'S', 'T', 'C', 'H'};
+constexpr std::uint32_t byte_order = 0x01020304;
 
-	m_containers.emplace(id, empty);
+std::uint64_t next_layout() {
+	static std::atomic<std::uint64_t> counter{1}; // 0 is never a layout
+	return counter++;
 }
 
-EntityID Scene::emplace() {
-	// get id
-	EntityID id;
-	if (m_recyclable.size()) {
-		id = m_recyclable.back();
-		m_recyclable.pop_back();
-	} else {
-		id = m_counter++;
-	}
+} // namespace
+
+Scene::Scene(Storage storage, std::pmr::memory_resource * resource)
+: m_resource(resource)
+, m_storage(storage)
+, m_entities(resource)
+, m_containers(resource)
+, m_registry(resource)
+, m_shorthand(resource)
+, m_ops(resource)
+, m_sparse(resource)
+, m_sparse_sets(resource)
+, m_queries(resource)
+, m_layout(next_layout()) {
+	// the empty archetype is always ID 0
+	archetype({});
+}
+
+Scene::~Scene() = default;
 
+EntityID Scene::emplace() {
+	STITCH_TRACE_SCOPE("stch::Scene::emplace");
 	// add to empty archetype
-	m_entities.emplace(id, arch::Record{m_containers.at(arch::ID{{}}), 0});
-	m_containers.at(arch::ID{{}}).m_storage.m_size++;
+	auto & empty = *m_containers.front();
+	auto id = m_entities.emplace(empty, empty.m_storage.m_size);
+	empty.push(id);
 
 	return id;
 }
 
 void Scene::erase(EntityID id) {
+	STITCH_TRACE_SCOPE("stch::Scene::erase");
 	// clean up
 	auto &record = m_entities.at(id);
-	arch::Record *end = nullptr;
-	for (auto &[eid, record_] : m_entities) {
-		if (record_.m_location == record.m_location && record_.m_row + 1 == record.m_location->m_storage.m_size) {
-			end = &record_;
+	record.m_location->erase(record.m_row, m_entities);
+	detach(id);
+
+	// recycle id
+	m_entities.erase(id);
+}
+
+bool Scene::is_alive(EntityID id) const {
+	return m_entities.contains(id);
+}
+
+Tick Scene::tick() const {
+	return m_tick;
+}
+
+Tick Scene::advance() {
+	return m_tick++;
+}
+
+void Scene::enroll(arch::Type type, const arch::Pool::Ops & ops) {
+	if (m_ops.size() <= type) {
+		m_ops.resize(type + 1, nullptr);
+		m_shorthand.resize(type + 1);
+		m_sparse.resize(type + 1);
+	}
+	m_ops[type] = &ops;
+
+	if (ops.m_sparse && !m_sparse[type]) {
+		m_sparse[type] = arch::make_owned<arch::SparseSet>(m_resource, ops, m_resource);
+		m_sparse_sets.push_back(m_sparse[type].get());
+	}
+}
+
+void Scene::consider(arch::SparseSet * set, arch::SparseSet *& smallest, bool & missing) {
+	if (!set) {
+		missing = true; // never added, so nothing can match
+	} else if (!smallest || set->size() < smallest->size()) {
+		smallest = set;
+	}
+}
+
+void Scene::detach(EntityID id) {
+	for (auto * set : m_sparse_sets) {
+		set->erase(id);
+	}
+}
+
+arch::Container & Scene::archetype(const arch::Kind & kind) {
+	auto found = m_registry.find(kind);
+	if (found != m_registry.end()) {
+		return *m_containers[found->second];
+	}
+
+	// create new archetype
+	arch::ID id{static_cast<std::uint32_t>(m_containers.size())};
+	auto temp = arch::make_owned<arch::Container>(m_resource, id, kind, m_ops, m_storage, m_resource);
+
+	catalogue(*temp);
+	return add_archetype(std::move(temp));
+}
+
+void Scene::catalogue(const arch::Container & container) {
+	// update component lookups
+	for (std::size_t column = 0; column < container.m_stored.size(); column++) {
+		m_shorthand[container.m_stored[column]].assign(container.m_id, column);
+	}
+
+	m_registry.emplace(container.m_types, container.m_id);
+}
+
+arch::Container & Scene::add_archetype(arch::Owned<arch::Container> container) {
+	auto & added = *m_containers.emplace_back(std::move(container));
+
+	for (auto & view : m_queries) {
+		if (view) {
+			view->include(added);
 		}
 	}
-	assert(end);
-	record.m_location->erase(record.m_row, end);
-	m_entities.erase(id);
 
-	// recycle id
-	constexpr auto max = std::numeric_limits<EntityID>::max();
-	constexpr auto next_gen = (max >> (sizeof(EntityID) * 4)) + 1;
-	m_recyclable.push_back(id + next_gen);
+	return added;
+}
+
+std::size_t Scene::allocate(arch::Container & target, std::size_t count, std::vector<EntityID> & ids) {
+	auto first = target.m_storage.m_size;
+	target.grow(first + count);
+
+	ids.reserve(ids.size() + count);
+	for (std::size_t i = 0; i < count; i++) {
+		auto id = m_entities.emplace(target, first + i);
+		target.m_entities.push_back(id);
+		ids.push_back(id);
+	}
+
+	target.m_storage.m_size += count;
+	return first;
+}
+
+void Scene::fill(arch::Container & target, std::size_t column, const std::byte * element, std::size_t first, std::size_t count) {
+	auto & pool = target.m_components[column];
+	const auto & ops = *m_ops[target.m_stored[column]];
+
+	for (auto row = first; row < first + count;) {
+		auto run = std::min(target.contiguous(row), first + count - row);
+		ops.fill(element, pool.get(row), run);
+		row += run;
+	}
+	pool.stamp(first, first + count, m_tick, true);
+}
+
+std::vector<EntityID> Scene::clone(EntityID id, std::size_t count) {
+	STITCH_TRACE_SCOPE("stch::Scene::clone");
+	auto & source = *m_entities.at(id).m_location;
+	auto row = m_entities.at(id).m_row;
+
+	for (auto type : source.m_types) {
+		m_ops[type]->check_copyable();
+	}
+	for (std::size_t type = 0; type < m_sparse.size(); type++) {
+		if (m_sparse[type] && m_sparse[type]->contains(id)) {
+			m_ops[type]->check_copyable();
+		}
+	}
+
+	std::vector<EntityID> ids;
+	auto first = allocate(source, count, ids);
+	for (std::size_t column = 0; column < source.m_stored.size(); column++) {
+		fill(source, column, source.m_components[column].get(row), first, count);
+	}
+
+	for (std::size_t type = 0; type < m_sparse.size(); type++) {
+		auto * set = m_sparse[type].get();
+		if (!set || !set->contains(id)) {
+			continue;
+		}
+
+		for (auto copy : ids) {
+			bool existed;
+			auto * slot = set->emplace(copy, existed);
+			m_ops[type]->fill(set->get(id), slot, 1); // the original may have moved to make room
+		}
+	}
+
+	return ids;
+}
+
+std::vector<EntityID> Scene::instantiate(const Prefab & prefab, std::size_t count) {
+	STITCH_TRACE_SCOPE("stch::Scene::instantiate");
+	if (prefab.m_layout != m_layout) {
+		for (const auto & value : prefab.m_values) {
+			enroll(value.m_type, *value.m_ops);
+		}
+		prefab.m_target = &archetype(prefab.m_kind);
+		prefab.m_layout = m_layout;
+	}
+	auto & target = *prefab.m_target;
+
+	std::vector<EntityID> ids;
+	auto first = allocate(target, count, ids);
+
+	for (const auto & value : prefab.m_values) {
+		if (value.m_ops->m_sparse) {
+			auto & set = *m_sparse[value.m_type];
+			for (auto id : ids) {
+				bool existed;
+				value.m_ops->fill(value.m_element, set.emplace(id, existed), 1);
+			}
+		} else if (value.m_element) {
+			fill(target, m_shorthand[value.m_type].at(target.m_id), value.m_element, first, count);
+		}
+	}
+
+	return ids;
+}
+
+Prefab Scene::prefab(EntityID id) const {
+	const auto & record = m_entities.at(id);
+	const auto & source = *record.m_location;
+
+	Prefab prefab;
+	prefab.m_values.reserve(source.m_types.size());
+	for (auto type : source.m_types) {
+		const auto & ops = *m_ops[type];
+		const std::byte * element = nullptr;
+		if (ops.m_size) {
+			element = source.m_components[m_shorthand[type].at(source.m_id)].get(record.m_row);
+		}
+		prefab.keep(type, ops, element);
+	}
+
+	for (std::size_t type = 0; type < m_sparse.size(); type++) {
+		if (m_sparse[type] && m_sparse[type]->contains(id)) {
+			prefab.keep(static_cast<arch::Type>(type), *m_ops[type], m_sparse[type]->get(id));
+		}
+	}
+
+	return prefab;
+}
+
+void Scene::erase_n(const std::vector<EntityID> & ids) {
+	STITCH_TRACE_SCOPE("stch::Scene::erase_n");
+	// group rows by archetype
+	std::map<arch::Container *, std::vector<std::size_t>> rows;
+	for (auto id : ids) {
+		if (!is_alive(id)) {
+			continue;
+		}
+
+		auto & record = m_entities[id];
+		rows[record.m_location].push_back(record.m_row);
+		detach(id);
+		m_entities.erase(id);
+	}
+
+	for (auto & [container, doomed] : rows) {
+		std::sort(doomed.begin(), doomed.end());
+		container->erase(doomed, m_entities);
+	}
+}
+
+void Scene::clear(arch::Container & container) {
+	for (auto id : container.m_entities) {
+		detach(id);
+		m_entities.erase(id);
+	}
+
+	container.clear();
+}
+
+void Scene::reset() {
+	for (auto & container : m_containers) {
+		container->clear();
+
+		// stop using the mapping before it goes; nothing is left to copy out
+		for (auto & pool : container->m_components) {
+			if (pool.borrowed()) {
+				pool.reallocate(container->m_storage.m_capacity);
+			}
+		}
+	}
+	m_mapping.reset();
+
+	for (auto * set : m_sparse_sets) {
+		set->clear();
+	}
+	m_entities.clear();
+}
+
+void Scene::save(std::ostream & stream) const {
+	STITCH_TRACE_SCOPE("stch::Scene::save");
+	Writer out(stream);
+	out.write(snapshot_magic, sizeof(snapshot_magic));
+	out.write(snapshot_version);
+	out.write(byte_order);
+
+	// type table, indexed by this scene's arch::Type
+	out.write(static_cast<std::uint64_t>(m_ops.size()));
+	for (const auto * ops : m_ops) {
+		std::string_view name = ops ? ops->m_info->name() : "";
+		out.write(static_cast<std::uint64_t>(name.size()));
+		out.write(name.data(), name.size());
+		out.write(static_cast<std::uint64_t>(ops ? ops->m_size : 0));
+	}
+
+	m_entities.save(out);
+
+	auto occupied = std::count_if(m_containers.begin(), m_containers.end(), [](const auto & container) {
+		return container->m_storage.m_size != 0;
+	});
+	out.write(static_cast<std::uint64_t>(occupied));
+
+	for (const auto & container : m_containers) {
+		auto rows = container->m_storage.m_size;
+		if (!rows) {
+			continue;
+		}
+
+		out.write(static_cast<std::uint64_t>(container->m_types.size()));
+		out.write(container->m_types.data(), container->m_types.size() * sizeof(arch::Type));
+		out.write(static_cast<std::uint64_t>(rows));
+		out.write(container->m_entities.data(), rows * sizeof(EntityID));
+
+		// one aligned block per column, written a chunk at a time with chunked storage
+		for (std::size_t column = 0; column < container->m_stored.size(); column++) {
+			const auto & pool = container->m_components[column];
+			const auto & ops = *m_ops[container->m_stored[column]];
+			out.align(column_block);
+			for (std::size_t row = 0; row < rows;) {
+				auto run = container->contiguous(row);
+				ops.save(out, pool.get(row), run);
+				row += run;
+			}
+		}
+	}
+
+	auto sparse = std::count_if(m_sparse.begin(), m_sparse.end(), [](const auto & set) {
+		return set && set->size() != 0;
+	});
+	out.write(static_cast<std::uint64_t>(sparse));
+
+	for (arch::Type type = 0; type < m_sparse.size(); type++) {
+		const auto * set = m_sparse[type].get();
+		if (!set || !set->size()) {
+			continue;
+		}
+
+		out.write(type);
+		out.write(static_cast<std::uint64_t>(set->size()));
+		for (std::size_t position = 0; position < set->size(); position++) {
+			out.write(set->entity(position));
+		}
+		for (std::size_t position = 0; position < set->size(); position++) {
+			m_ops[type]->save(out, set->get(set->entity(position)), 1);
+		}
+	}
+}
+
+void Scene::load(Reader & in, bool borrow) {
+	STITCH_TRACE_SCOPE("stch::Scene::restore");
+	if (in.remaining() < sizeof(snapshot_magic) || std::memcmp(in.take(sizeof(snapshot_magic)), snapshot_magic, sizeof(snapshot_magic))) {
+		throw std::runtime_error("stch::Scene::restore: not a snapshot");
+	}
+	auto version = in.read<std::uint32_t>();
+	if (version == 0 || version > snapshot_version) {
+		throw std::runtime_error("stch::Scene::restore: unsupported snapshot version");
+	}
+	if (in.read<std::uint32_t>() != byte_order) {
+		throw std::runtime_error("stch::Scene::restore: snapshot has a different byte order");
+	}
+
+	// match the snapshot's types to ours by name; unknown ones only fail once used
+	std::unordered_map<std::string_view, arch::Type> names;
+	for (arch::Type type = 0; type < m_ops.size(); type++) {
+		if (m_ops[type]) {
+			names.emplace(m_ops[type]->m_info->name(), type);
+		}
+	}
+
+	// element count, checked against what is left so that corrupt counts fail early
+	auto count = [&](std::size_t element) {
+		auto value = in.read<std::uint64_t>();
+		if (value > in.remaining() / element) {
+			throw std::runtime_error("stch::Scene::restore: truncated snapshot");
+		}
+		return static_cast<std::size_t>(value);
+	};
+
+	struct Entry {
+		std::string m_name;
+		arch::Type m_type;
+	};
+
+	std::vector<Entry> table(count(2 * sizeof(std::uint64_t)));
+	for (auto & entry : table) {
+		auto length = in.read<std::uint64_t>();
+		entry.m_name.assign(reinterpret_cast<const char *>(in.take(length)), length);
+		auto size = in.read<std::uint64_t>();
+
+		auto found = names.find(entry.m_name);
+		entry.m_type = found == names.end() ? arch::no_type : found->second;
+		if (found != names.end() && m_ops[found->second]->m_size != size) {
+			throw std::runtime_error("stch::Scene::restore: size of " + entry.m_name + " changed");
+		}
+	}
+
+	auto resolve = [&](arch::Type index) {
+		if (index >= table.size()) {
+			throw std::runtime_error("stch::Scene::restore: corrupt type table");
+		}
+		if (table[index].m_type == arch::no_type) {
+			throw std::runtime_error("stch::Scene::restore: unknown component type " + table[index].m_name);
+		}
+		return table[index].m_type;
+	};
+
+	reset();
+
+	try {
+		m_entities.load(in);
+
+		auto archetypes = in.read<std::uint64_t>();
+		for (std::uint64_t i = 0; i < archetypes; i++) {
+			arch::Kind saved(count(sizeof(arch::Type)));
+			in.read(saved.data(), saved.size() * sizeof(arch::Type));
+
+			arch::Kind kind;
+			for (auto index : saved) {
+				kind.push_back(resolve(index));
+				if (m_ops[kind.back()]->m_sparse) {
+					throw std::runtime_error("stch::Scene::restore: " + table[index].m_name + " has become sparse");
+				}
+			}
+			std::sort(kind.begin(), kind.end());
+			if (std::adjacent_find(kind.begin(), kind.end()) != kind.end()) {
+				throw std::runtime_error("stch::Scene::restore: archetype repeats a type");
+			}
+
+			auto & container = archetype(kind);
+			if (container.m_storage.m_size) {
+				throw std::runtime_error("stch::Scene::restore: duplicate archetype");
+			}
+
+			auto rows = count(sizeof(EntityID));
+			auto * ids = in.take(rows * sizeof(EntityID));
+
+			// raw columns of contiguous archetypes are used in place, so only give
+			// buffers to the others
+			if (borrow && rows && !container.m_storage.m_chunked) {
+				container.reserve_borrowed(rows);
+			} else {
+				container.reserve(rows);
+			}
+
+			// rows constructed in each column so far; the container only owns them
+			// once its size is set, so they are destroyed here if loading fails
+			struct Loaded {
+				arch::Pool * m_pool;
+				const arch::Pool::Ops * m_ops;
+				std::size_t m_rows;
+			};
+			std::vector<Loaded> loaded;
+
+			try {
+				// columns come in the saved type order, tags have none
+				for (auto index : saved) {
+					auto type = resolve(index);
+					if (!m_ops[type]->m_size) {
+						continue;
+					}
+
+					const auto & ops = *m_ops[type];
+					auto & pool = container.m_components[m_shorthand[type].at(container.m_id)];
+					if (version >= 2) {
+						in.align(column_block);
+					}
+					auto & column = loaded.emplace_back(Loaded{&pool, &ops, 0});
+
+					// a raw column filling a whole contiguous pool can stay where it is
+					bool in_place = borrow && rows && ops.m_raw && !container.m_storage.m_chunked && container.m_storage.m_capacity == rows;
+					if (in_place) {
+						auto * block = const_cast<std::byte *>(in.take(rows * ops.m_size));
+						if (reinterpret_cast<std::uintptr_t>(block) % ops.m_align == 0) {
+							pool.borrow(block);
+						} else {
+							if (pool.borrowed()) {
+								pool.reallocate(rows); // left without a buffer by reserve_borrowed
+							}
+							std::memcpy(pool.get(0), block, rows * ops.m_size);
+						}
+					} else if (ops.m_load) {
+						// hooks construct one element at a time, and may throw for any of them
+						for (; column.m_rows < rows; column.m_rows++) {
+							ops.load(in, pool.get(column.m_rows), 1);
+						}
+					} else {
+						for (std::size_t row = 0; row < rows;) {
+							auto run = container.contiguous(row, rows);
+							ops.load(in, pool.get(row), run);
+							row += run;
+						}
+					}
+
+					column.m_rows = rows;
+					pool.stamp(0, rows, m_tick, true);
+				}
+			} catch (...) {
+				for (const auto & column : loaded) {
+					for (std::size_t row = 0; row < column.m_rows; row++) {
+						column.m_ops->destroy(column.m_pool->get(row));
+					}
+				}
+				throw;
+			}
+
+			container.m_entities.resize(rows);
+			if (rows) {
+				std::memcpy(container.m_entities.data(), ids, rows * sizeof(EntityID));
+			}
+			container.m_storage.m_size = rows;
+
+			for (std::size_t row = 0; row < rows; row++) {
+				m_entities.place(container.m_entities[row], container, row);
+			}
+		}
+
+		auto sparse = in.read<std::uint64_t>();
+		for (std::uint64_t i = 0; i < sparse; i++) {
+			auto index = in.read<arch::Type>();
+			auto type = resolve(index);
+			if (type >= m_sparse.size() || !m_sparse[type]) {
+				throw std::runtime_error("stch::Scene::restore: " + table[index].m_name + " is no longer sparse");
+			}
+
+			auto & set = *m_sparse[type];
+			std::vector<EntityID> ids(count(sizeof(EntityID)));
+			in.read(ids.data(), ids.size() * sizeof(EntityID));
+			for (auto id : ids) {
+				if (!m_entities.contains(id)) {
+					throw std::runtime_error("stch::Scene::restore: sparse component of a dead entity");
+				}
+
+				bool existed;
+				auto * slot = set.emplace(id, existed);
+				if (existed) {
+					throw std::runtime_error("stch::Scene::restore: duplicate sparse component");
+				}
+				try {
+					m_ops[type]->load(in, slot, 1);
+				} catch (...) {
+					set.vacate(id); // nothing was constructed in the slot
+					throw;
+				}
+			}
+		}
+	} catch (...) {
+		reset();
+		throw;
+	}
+}
+
+std::size_t Scene::migrate(arch::Record & record, arch::Container & target) {
+	m_counters.m_migrations++;
+
+	std::size_t row;
+	if (m_time_migrations) {
+		auto start = std::chrono::steady_clock::now();
+		row = target.steal(*record.m_location, record.m_row, m_shorthand, m_entities);
+		m_counters.m_steal_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	} else {
+		row = target.steal(*record.m_location, record.m_row, m_shorthand, m_entities);
+	}
+
+	record = arch::Record(target, row);
+	return row;
+}
+
+Stats Scene::stats() const {
+	Stats stats;
+	stats.m_counters = m_counters;
+
+	for (const auto & container : m_containers) {
+		const auto & storage = container->m_storage;
+
+		Stats::Archetype archetype{container->m_id, container->m_types, storage.m_size, storage.m_capacity, 0, 0, {}};
+		std::size_t row_bytes = 0;
+		for (auto type : container->m_stored) {
+			auto size = m_ops[type]->m_size;
+			archetype.m_columns.push_back({type, storage.m_capacity * size});
+			archetype.m_bytes += storage.m_capacity * size;
+			row_bytes += size;
+		}
+		archetype.m_wasted = (storage.m_capacity - storage.m_size) * row_bytes;
+
+		stats.m_entities += archetype.m_entities;
+		stats.m_bytes += archetype.m_bytes;
+		stats.m_wasted += archetype.m_wasted;
+		stats.m_counters.m_reallocations += container->m_reallocations;
+		stats.m_archetypes.push_back(std::move(archetype));
+	}
+
+	return stats;
+}
+
+void Scene::reset_stats() {
+	m_counters = {};
+	for (auto & container : m_containers) {
+		container->m_reallocations = 0;
+	}
+}
+
+void Scene::time_migrations(bool enabled) {
+	m_time_migrations = enabled;
+}
+
+void Scene::compact(const Compaction & policy) {
+	STITCH_TRACE_SCOPE("stch::Scene::compact");
+	if (policy.m_archetypes) {
+		prune();
+	}
+
+	for (auto & container : m_containers) {
+		const auto & storage = container->m_storage;
+		if (static_cast<double>(storage.m_size) < static_cast<double>(storage.m_capacity) * policy.m_occupancy) {
+			container->shrink_to_fit();
+		}
+	}
+}
+
+void Scene::prune() {
+	auto dropped = [](const arch::Container & container) {
+		return container.m_id != 0 && container.m_storage.m_size == 0;
+	};
+
+	if (std::none_of(m_containers.begin(), m_containers.end(), [&](const auto & container) { return dropped(*container); })) {
+		return;
+	}
+
+	for (auto & container : m_containers) {
+		for (auto * edges : {&container->m_forward, &container->m_backward}) {
+			edges->erase(std::remove_if(edges->begin(), edges->end(), [&](const arch::Container::Edge & edge) {
+				return dropped(*edge.m_target);
+			}), edges->end());
+		}
+	}
+
+	m_registry.clear();
+	for (auto & columns : m_shorthand) {
+		columns.m_columns.clear();
+	}
+
+	std::uint32_t kept = 0;
+	for (std::size_t i = 0; i < m_containers.size(); i++) {
+		auto & container = *m_containers[i];
+		if (dropped(container)) {
+			m_counters.m_reallocations += container.m_reallocations; // keep stats() totals
+			m_containers[i].reset();
+			continue;
+		}
+
+		container.m_id = arch::ID{kept};
+		catalogue(container);
+		if (kept != i) {
+			m_containers[kept] = std::move(m_containers[i]);
+		}
+		kept++;
+	}
+	m_containers.erase(m_containers.begin() + kept, m_containers.end());
+	m_layout = next_layout();
+
+	for (auto & view : m_queries) {
+		if (view) {
+			view->rebuild();
+		}
+	}
 }
 
-bool Scene::is_alive(EntityID id) {
-	return m_entities.count(id);
+void Scene::flush(CommandBuffer & commands) {
+	apply({&commands});
+}
+
+void Scene::flush(std::vector<CommandBuffer> & commands) {
+	std::vector<CommandBuffer *> buffers;
+	for (auto & buffer : commands) {
+		buffers.push_back(&buffer);
+	}
+	apply(buffers);
+}
+
+void Scene::place(arch::SparseSet & set, EntityID id, const CommandBuffer::Command & change) {
+	if (change.m_op == CommandBuffer::Op::Remove) {
+		set.erase(id);
+		return;
+	}
+
+	bool existed;
+	auto * slot = set.emplace(id, existed);
+	if (existed) {
+		change.m_ops->destroy(slot);
+	}
+	if (change.m_ops->m_size) {
+		change.m_ops->relocate(change.m_payload, slot);
+	}
+}
+
+void Scene::apply(const std::vector<CommandBuffer *> & buffers) {
+	STITCH_TRACE_SCOPE("stch::Scene::flush");
+	using Command = CommandBuffer::Command;
+	using Op = CommandBuffer::Op;
+
+	struct Pending {
+		bool m_erase = false;
+		std::map<arch::Type, const Command *> m_changes; // latest add or remove per type
+	};
+
+	auto discard = [](const Command * command) {
+		if (command->m_op == Op::Add) {
+			command->m_ops->destroy(command->m_payload);
+		}
+	};
+
+	// collapse commands into the final change set of each entity
+	std::map<EntityID, Pending> pending;
+	for (auto * buffer : buffers) {
+		buffer->m_resolved.resize(buffer->m_created);
+
+		for (auto & command : buffer->m_commands) {
+			if (command.m_op == Op::Create) {
+				buffer->m_resolved[entity::index(command.m_entity)] = emplace();
+				continue;
+			}
+
+			auto id = buffer->resolve(command.m_entity);
+			if (!is_alive(id)) {
+				discard(&command);
+				continue;
+			}
+
+			auto & entry = pending[id];
+			if (entry.m_erase) {
+				discard(&command);
+				continue;
+			}
+
+			if (command.m_op == Op::Destroy) {
+				for (auto & [type, change] : entry.m_changes) {
+					discard(change);
+				}
+				entry.m_changes.clear();
+				entry.m_erase = true;
+				continue;
+			}
+
+			auto & change = entry.m_changes[command.m_type];
+			if (change) {
+				discard(change);
+			}
+			change = &command;
+
+			if (command.m_op == Op::Add) {
+				enroll(command.m_type, *command.m_ops);
+			}
+		}
+	}
+
+	// resolve target archetypes, then move entities grouped by target
+	std::vector<std::pair<arch::Container *, EntityID>> moves;
+	std::vector<EntityID> erased;
+	for (auto & [id, entry] : pending) {
+		if (entry.m_erase) {
+			erased.push_back(id);
+			continue;
+		}
+
+		auto kind = m_entities[id].m_location->m_types;
+		for (auto & [type, change] : entry.m_changes) {
+			if (type < m_sparse.size() && m_sparse[type]) {
+				continue; // sparse components do not change the archetype
+			}
+
+			auto position = std::lower_bound(kind.begin(), kind.end(), type);
+			bool present = position != kind.end() && *position == type;
+
+			if (change->m_op == Op::Add && !present) {
+				kind.insert(position, type);
+			} else if (change->m_op == Op::Remove && present) {
+				kind.erase(position);
+			}
+		}
+
+		moves.emplace_back(&archetype(kind), id);
+	}
+
+	std::stable_sort(moves.begin(), moves.end(), [](const auto & lhs, const auto & rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	for (std::size_t begin = 0; begin < moves.size();) {
+		auto & target = *moves[begin].first;
+
+		auto end = begin;
+		std::size_t arriving = 0;
+		while (end < moves.size() && moves[end].first == &target) {
+			arriving += m_entities[moves[end].second].m_location != &target;
+			end++;
+		}
+
+		// grow pools once for the whole group
+		target.grow(target.m_storage.m_size + arriving);
+
+		for (; begin < end; begin++) {
+			auto id = moves[begin].second;
+			auto & record = m_entities[id];
+			auto previous = record.m_location->m_types;
+
+			if (record.m_location != &target) {
+				migrate(record, target);
+			}
+
+			for (auto & [type, change] : pending.at(id).m_changes) {
+				if (type < m_sparse.size() && m_sparse[type]) {
+					place(*m_sparse[type], id, *change);
+					continue;
+				}
+
+				if (change->m_op != Op::Add || !change->m_ops->m_size) {
+					continue; // removals and tags have nothing to place
+				}
+
+				auto & pool = target.m_components[m_shorthand[type].at(target.m_id)];
+				auto * slot = pool.get(record.m_row);
+				bool replaced = std::binary_search(previous.begin(), previous.end(), type);
+				if (replaced) {
+					// replacing an existing component
+					change->m_ops->destroy(slot);
+				}
+				change->m_ops->relocate(change->m_payload, slot);
+				pool.stamp(record.m_row, record.m_row + 1, m_tick, !replaced);
+			}
+		}
+	}
+
+	for (auto id : erased) {
+		erase(id);
+	}
+
+	// payloads have all been consumed
+	for (auto * buffer : buffers) {
+		buffer->release();
+		buffer->m_flushed = true;
+	}
 }
 
 }
@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Schedule.hpp"
+
+#include "Stitch/Workers.hpp"
+
+#include <algorithm>
+
+namespace stch {
+
+Schedule::Schedule(Scene & scene)
+: m_scene(scene) {
+}
+
+std::size_t Schedule::add(std::string name, arch::Signature reads, arch::Signature writes, std::function<void(Scene &)> system) {
+	System added{std::move(system), std::move(reads), std::move(writes), 0};
+
+	// run after every earlier system it conflicts with
+	for (const auto & earlier : m_systems) {
+		if (conflicts(earlier, added)) {
+			added.m_stage = std::max(added.m_stage, earlier.m_stage + 1);
+		}
+	}
+
+	auto index = m_systems.size();
+	if (m_stages.size() <= added.m_stage) {
+		m_stages.resize(added.m_stage + 1);
+	}
+	m_stages[added.m_stage].push_back(index);
+
+	m_systems.push_back(std::move(added));
+	m_timings.push_back({std::move(name)});
+
+	return index;
+}
+
+bool Schedule::conflicts(const System & first, const System & second) {
+	return first.m_writes.intersects(second.m_writes)
+		|| first.m_writes.intersects(second.m_reads)
+		|| first.m_reads.intersects(second.m_writes);
+}
+
+void Schedule::run(Workers & workers) {
+	for (const auto & stage : m_stages) {
+		if (stage.size() == 1) {
+			execute(stage.front());
+		} else {
+			workers.run(stage.size(), [&](std::size_t task) {
+				execute(stage[task]);
+			});
+		}
+	}
+}
+
+void Schedule::execute(std::size_t system) {
+	auto start = std::chrono::steady_clock::now();
+	m_systems[system].m_run(m_scene);
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	auto & timing = m_timings[system];
+	timing.m_last = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+	timing.m_total += timing.m_last;
+	timing.m_runs++;
+}
+
+std::size_t Schedule::size() const {
+	return m_systems.size();
+}
+
+const std::vector<std::vector<std::size_t>> & Schedule::stages() const {
+	return m_stages;
+}
+
+const std::vector<Schedule::Timing> & Schedule::timings() const {
+	return m_timings;
+}
+
+} // namespace stch
@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Snapshot.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace stch {
+
+Writer::Writer(std::ostream & out)
+: m_out(out)
+, m_written(0) {
+}
+
+void Writer::write(const void * data, std::size_t size) {
+	m_out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+	m_written += size;
+}
+
+void Writer::align(std::size_t alignment) {
+	static constexpr char zeros[column_block] = {};
+
+	auto padding = (alignment - m_written % alignment) % alignment;
+	while (padding) {
+		auto size = std::min(padding, sizeof(zeros));
+		write(zeros, size);
+		padding -= size;
+	}
+}
+
+Reader::Reader(const std::byte * data, std::size_t size)
+: m_data(data)
+, m_size(size)
+, m_position(0) {
+}
+
+void Reader::read(void * data, std::size_t size) {
+	if (size) {
+		std::memcpy(data, take(size), size);
+	}
+}
+
+const std::byte * Reader::take(std::size_t size) {
+	if (size > remaining()) {
+		throw std::runtime_error("stch::Reader: truncated snapshot");
+	}
+
+	auto * data = m_data + m_position;
+	m_position += size;
+	return data;
+}
+
+void Reader::align(std::size_t alignment) {
+	take((alignment - m_position % alignment) % alignment);
+}
+
+std::size_t Reader::remaining() const {
+	return m_size - m_position;
+}
+
+} // namespace stch
+
+namespace stch::arch {
+
+std::vector<std::byte> read_all(std::istream & in) {
+	std::vector<std::byte> bytes;
+
+	// read in large blocks rather than per character
+	constexpr std::size_t block = std::size_t{1} << 20;
+	while (in) {
+		auto size = bytes.size();
+		bytes.resize(size + block);
+		in.read(reinterpret_cast<char *>(bytes.data() + size), static_cast<std::streamsize>(block));
+		bytes.resize(size + static_cast<std::size_t>(in.gcount()));
+	}
+
+	return bytes;
+}
+
+Mapping::Mapping(const std::string & path)
+: m_data(nullptr)
+, m_size(0) {
+	auto file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::system_error(errno, std::generic_category(), "stch::arch::Mapping: " + path);
+	}
+
+	struct stat status;
+	if (::fstat(file, &status) != 0) {
+		auto error = errno;
+		::close(file);
+		throw std::system_error(error, std::generic_category(), "stch::arch::Mapping: " + path);
+	}
+
+	m_size = static_cast<std::size_t>(status.st_size);
+	if (m_size) {
+		auto * data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED) {
+			auto error = errno;
+			::close(file);
+			throw std::system_error(error, std::generic_category(), "stch::arch::Mapping: " + path);
+		}
+		m_data = static_cast<std::byte *>(data);
+	}
+
+	// the mapping stays valid without the descriptor
+	::close(file);
+}
+
+Mapping::~Mapping() {
+	if (m_data) {
+		::munmap(m_data, m_size);
+	}
+}
+
+std::byte * Mapping::data() const {
+	return m_data;
+}
+
+std::size_t Mapping::size() const {
+	return m_size;
+}
+
+} // namespace stch::arch
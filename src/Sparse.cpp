@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Sparse.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace stch::arch {
+
+SparseSet::SparseSet(const Pool::Ops & ops, std::pmr::memory_resource * resource)
+: m_storage{0, 0, resource, false, 0, std::pmr::vector<Owned<Chunk>>(resource)}
+, m_pool(Pool::create(m_storage, ops))
+, m_dense(resource)
+, m_sparse(resource) {
+}
+
+std::byte * SparseSet::emplace(EntityID id, bool & existed) {
+	auto index = entity::index(id);
+	if (m_sparse.size() <= index) {
+		m_sparse.resize(index + 1, npos);
+	}
+
+	existed = contains(id);
+	if (existed) {
+		return m_pool.get(m_sparse[index]);
+	}
+
+	if (m_storage.m_size == m_storage.m_capacity) {
+		auto capacity = std::max<std::size_t>(16, m_storage.m_capacity * 2);
+		m_pool.reallocate(capacity);
+		m_storage.m_capacity = capacity;
+	}
+
+	auto position = m_storage.m_size++;
+	m_sparse[index] = static_cast<std::uint32_t>(position);
+	m_dense.push_back(id);
+
+	return m_pool.get(position);
+}
+
+void SparseSet::erase(EntityID id) {
+	if (!contains(id)) {
+		return;
+	}
+
+	m_pool.m_ops->destroy(get(id));
+	vacate(id);
+}
+
+void SparseSet::vacate(EntityID id) {
+	assert(contains(id));
+
+	auto position = m_sparse[entity::index(id)];
+	m_pool.vacate(position); // backfills from the last position
+
+	m_dense[position] = m_dense.back();
+	m_sparse[entity::index(m_dense[position])] = position;
+	m_sparse[entity::index(id)] = npos;
+
+	m_dense.pop_back();
+	m_storage.m_size--;
+}
+
+void SparseSet::clear() {
+	for (auto id : m_dense) {
+		m_pool.m_ops->destroy(m_pool.get(m_sparse[entity::index(id)]));
+		m_sparse[entity::index(id)] = npos;
+	}
+
+	m_dense.clear();
+	m_storage.m_size = 0;
+}
+
+bool SparseSet::contains(EntityID id) const {
+	auto index = entity::index(id);
+	return index < m_sparse.size() && m_sparse[index] != npos && m_dense[m_sparse[index]] == id;
+}
+
+std::byte * SparseSet::get(EntityID id) const {
+	return contains(id) ? m_pool.get(m_sparse[entity::index(id)]) : nullptr;
+}
+
+std::size_t SparseSet::size() const {
+	return m_dense.size();
+}
+
+EntityID SparseSet::entity(std::size_t position) const {
+	assert(position < m_dense.size());
+	return m_dense[position];
+}
+
+} // namespace stch::arch
@@ -0,0 +1,13 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Stats.hpp"
+
+namespace stch {
+
+double Stats::edge_hit_rate() const {
+	auto lookups = m_counters.m_edge_hits + m_counters.m_edge_misses;
+	return lookups ? static_cast<double>(m_counters.m_edge_hits) / static_cast<double>(lookups) : 0.0;
+}
+
+} // namespace stch
@@ -3,14 +3,15 @@
 
 #include "Stitch/Types.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
 namespace stch::arch {
 
-ID::ID(const Kind &kind) {
-	std::hash<std::type_index> hasher;
-	m_value = static_cast<uint32_t>(kind.size());
-	for (auto type : kind) {
-		m_value ^= hasher(type) + 0x9e3779b9 + (m_value << 6) + (m_value >> 2);
-	}
+Type next_type() {
+	static std::atomic<Type> counter{0};
+	return counter++;
 }
 
 ID::operator std::uint32_t() const {
@@ -21,8 +22,76 @@ bool ID::operator==(ID other) const {
 	return m_value == other.m_value;
 }
 
-std::size_t ID::Hash::operator()(ID value) const {
-	return std::hash<std::uint32_t>()(value);
+std::size_t KindHash::operator()(const Kind & kind) const {
+	std::size_t value = kind.size();
+	for (auto type : kind) {
+		value ^= type + 0x9e3779b9 + (value << 6) + (value >> 2);
+	}
+	return value;
+}
+
+Signature::Signature(const Kind & kind) {
+	for (auto type : kind) {
+		set(type);
+	}
+}
+
+void Signature::set(Type type) {
+	if (m_words.size() <= type / 64) {
+		m_words.resize(type / 64 + 1, 0);
+	}
+	m_words[type / 64] |= std::uint64_t{1} << (type % 64);
+}
+
+bool Signature::test(Type type) const {
+	return type / 64 < m_words.size() && (m_words[type / 64] >> (type % 64)) & 1;
+}
+
+bool Signature::includes(const Signature & other) const {
+	for (std::size_t i = 0; i < other.m_words.size(); i++) {
+		auto word = i < m_words.size() ? m_words[i] : 0;
+		if ((word & other.m_words[i]) != other.m_words[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TypeMap::TypeMap(const allocator_type & allocator)
+: m_columns(allocator) {
+}
+
+TypeMap::TypeMap(const TypeMap & other, const allocator_type & allocator)
+: m_columns(other.m_columns, allocator) {
+}
+
+TypeMap::TypeMap(TypeMap && other, const allocator_type & allocator)
+: m_columns(std::move(other.m_columns), allocator) {
+}
+
+bool Signature::intersects(const Signature & other) const {
+	for (std::size_t i = 0; i < std::min(m_words.size(), other.m_words.size()); i++) {
+		if (m_words[i] & other.m_words[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TypeMap::contains(ID id) const {
+	return id < m_columns.size() && m_columns[id] != npos;
+}
+
+std::size_t TypeMap::at(ID id) const {
+	assert(contains(id));
+	return m_columns[id];
+}
+
+void TypeMap::assign(ID id, std::size_t column) {
+	if (m_columns.size() <= id) {
+		m_columns.resize(id + 1, npos);
+	}
+	m_columns[id] = column;
 }
 
 } // namespace stch::arch
@@ -5,7 +5,8 @@
 
 #include "Stitch/Scene.hpp"
 
-#include <algorithm>
+#include <atomic>
+#include <utility>
 
 namespace stch {
 
@@ -16,11 +17,11 @@ View::Iterator::Iterator(
 : m_parent(parent)
 , m_archetypes_idx(archetypes_idx)
 , m_row(row) {
+	skip_empty();
 }
 
 std::pair<arch::Container &, std::size_t> View::Iterator::operator*() {
-	auto & current_container = m_parent.m_scene.m_containers.at(m_parent.m_archetypes.at(m_archetypes_idx));
-	return {current_container, m_row};
+	return {*m_parent.m_archetypes.at(m_archetypes_idx), m_row};
 }
 
 bool View::Iterator::operator==(const Iterator & rhs) const {
@@ -36,10 +37,11 @@ bool View::Iterator::operator!=(const Iterator & rhs) const {
 }
 
 View::Iterator & View::Iterator::operator++() {
-	auto & current_container = m_parent.m_scene.m_containers.at(m_parent.m_archetypes.at(m_archetypes_idx));
+	auto & current_container = *m_parent.m_archetypes.at(m_archetypes_idx);
 	if (current_container.m_storage.m_size == m_row + 1) {
 		m_row = 0;
 		m_archetypes_idx++;
+		skip_empty();
 	} else {
 		m_row++;
 	}
@@ -53,29 +55,27 @@ View::Iterator View::Iterator::operator++(int) {
 	return temp;
 }
 
-View::View(Scene & scene, std::vector<std::type_index> requested)
-: m_scene(scene) {
-	if (!m_scene.m_shorthand.count(requested.front())) {
-		return;
-	}
-
-	std::sort(requested.begin(), requested.end());
-
-	const auto & type_map = m_scene.m_shorthand.at(requested.front());
-	std::vector<arch::ID> options;
-	options.reserve(type_map.size());
-	for (auto &[id, column] : type_map) {
-		options.push_back(id);
+void View::Iterator::skip_empty() {
+	while (
+		m_archetypes_idx < m_parent.m_archetypes.size() &&
+		m_parent.m_archetypes[m_archetypes_idx]->m_storage.m_size == 0
+	) {
+		m_archetypes_idx++;
 	}
+}
 
-	m_archetypes.reserve(options.size());
-	for (auto id : options) {
-		if (std::includes(m_scene.m_containers.at(id).m_types.begin(), m_scene.m_containers.at(id).m_types.end(), requested.begin(), requested.end())) {
-			if (m_scene.m_containers.at(id).m_storage.m_size) {
-				m_archetypes.push_back(id);
-			}
-		}
-	}
+View::View(
+	Scene & scene,
+	std::vector<arch::Type> columns,
+	arch::Signature required,
+	arch::Signature excluded)
+: m_scene(scene)
+, m_requested(columns.begin(), columns.end(), scene.m_resource)
+, m_required(std::move(required))
+, m_excluded(std::move(excluded))
+, m_archetypes(scene.m_resource)
+, m_columns(scene.m_resource) {
+	rebuild();
 }
 
 View::Iterator View::begin() {
@@ -86,10 +86,39 @@ View::Iterator View::end() {
 	return Iterator(*this, m_archetypes.size(), 0);
 }
 
+const std::pmr::vector<arch::Container *> & View::archetypes() const {
+	return m_archetypes;
+}
 
+std::size_t View::column(std::size_t archetype, std::size_t term) const {
+	return m_columns[archetype * m_requested.size() + term];
+}
 
-} // namespace stch
+void View::include(arch::Container & container) {
+	if (!container.m_signature.includes(m_required) || container.m_signature.intersects(m_excluded)) {
+		return;
+	}
+
+	m_archetypes.push_back(&container);
+	for (auto type : m_requested) {
+		// filters, tags and missing optional components have no column
+		bool stored = type < m_scene.m_shorthand.size() && m_scene.m_shorthand[type].contains(container.m_id);
+		m_columns.push_back(stored ? m_scene.m_shorthand[type].at(container.m_id) : arch::TypeMap::npos);
+	}
+}
+
+void View::rebuild() {
+	m_archetypes.clear();
+	m_columns.clear();
 
-// ..401 Baz Bar Foo
-// ..905 Bar Foo
-// ..548 Foo
+	for (auto & container : m_scene.m_containers) {
+		include(*container);
+	}
+}
+
+std::size_t View::next_index() {
+	static std::atomic<std::size_t> counter{0};
+	return counter++;
+}
+
+} // namespace stch
@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Workers.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace stch {
+
+Workers::Workers(std::size_t threads)
+: m_queues(std::max<std::size_t>(threads, 1))
+, m_task(nullptr)
+, m_generation(0)
+, m_finished(0)
+, m_stop(false) {
+	// participant 0 is whichever thread calls run()
+	for (std::size_t i = 1; i < m_queues.size(); i++) {
+		m_threads.emplace_back(&Workers::loop, this, i);
+	}
+}
+
+Workers::~Workers() {
+	{
+		std::lock_guard lock{m_mutex};
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (auto & thread : m_threads) {
+		thread.join();
+	}
+}
+
+std::size_t Workers::size() const {
+	return m_queues.size();
+}
+
+void Workers::run(std::size_t count, const std::function<void(std::size_t)> & task) {
+	if (count == 0) {
+		return;
+	}
+
+	{
+		std::lock_guard lock{m_mutex};
+
+		// hand every participant a contiguous block, the rest is balanced by stealing
+		auto block = (count + m_queues.size() - 1) / m_queues.size();
+		for (std::size_t i = 0; i < m_queues.size(); i++) {
+			std::lock_guard queue_lock{m_queues[i].m_mutex};
+			m_queues[i].m_begin = std::min(i * block, count);
+			m_queues[i].m_end = std::min((i + 1) * block, count);
+		}
+
+		m_task = &task;
+		m_finished = 0;
+		m_error = nullptr;
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	work(0);
+
+	// `task` must outlive every call, so wait even when one of them failed
+	std::unique_lock lock{m_mutex};
+	m_done.wait(lock, [&] { return m_finished == m_threads.size(); });
+	m_task = nullptr;
+
+	if (auto error = std::exchange(m_error, nullptr)) {
+		lock.unlock();
+		std::rethrow_exception(error);
+	}
+}
+
+void Workers::loop(std::size_t self) {
+	std::size_t seen = 0;
+
+	while (true) {
+		{
+			std::unique_lock lock{m_mutex};
+			m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+			if (m_stop) {
+				return;
+			}
+			seen = m_generation;
+		}
+
+		work(self);
+
+		{
+			std::lock_guard lock{m_mutex};
+			m_finished++;
+		}
+		m_done.notify_one();
+	}
+}
+
+void Workers::work(std::size_t self) {
+	std::size_t task;
+	while (pop(self, task) || steal(self, task)) {
+		try {
+			(*m_task)(task);
+		} catch (...) {
+			fail(std::current_exception());
+		}
+	}
+}
+
+void Workers::fail(std::exception_ptr error) {
+	{
+		std::lock_guard lock{m_mutex};
+		if (!m_error) {
+			m_error = std::move(error);
+		}
+	}
+
+	for (auto & queue : m_queues) {
+		std::lock_guard lock{queue.m_mutex};
+		queue.m_begin = queue.m_end;
+	}
+}
+
+bool Workers::pop(std::size_t self, std::size_t & task) {
+	auto & queue = m_queues[self];
+	std::lock_guard lock{queue.m_mutex};
+
+	if (queue.m_begin == queue.m_end) {
+		return false;
+	}
+
+	task = queue.m_begin++;
+	return true;
+}
+
+bool Workers::steal(std::size_t self, std::size_t & task) {
+	for (std::size_t offset = 1; offset < m_queues.size(); offset++) {
+		auto & victim = m_queues[(self + offset) % m_queues.size()];
+		std::lock_guard lock{victim.m_mutex};
+
+		// take from the back, away from where the owner is working
+		if (victim.m_begin != victim.m_end) {
+			task = --victim.m_end;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+} // namespace stch
@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Scene.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+TEST_CASE("CommandBuffer") {
+	stch::Scene registry;
+	stch::CommandBuffer commands;
+
+	struct Foo {
+		int m_value;
+	};
+	struct Bar {
+		std::string m_name;
+	};
+
+	SECTION("Nothing happens before flushing") {
+		auto id = registry.emplace();
+		commands.emplace<Foo>(id, Foo{1});
+		REQUIRE_FALSE(registry.all_of<Foo>(id));
+		REQUIRE_FALSE(commands.empty());
+
+		registry.flush(commands);
+		REQUIRE(commands.empty());
+		REQUIRE(registry.get<Foo>(id)->m_value == 1);
+	}
+
+	SECTION("Placeholders resolve to created entities") {
+		auto placeholder = commands.emplace();
+		REQUIRE(stch::CommandBuffer::is_placeholder(placeholder));
+		commands.emplace<Foo>(placeholder, Foo{2});
+		commands.emplace<Bar>(placeholder, Bar{"bar"});
+
+		registry.flush(commands);
+		auto id = commands.resolve(placeholder);
+		REQUIRE(registry.is_alive(id));
+		REQUIRE(registry.get<Foo>(id)->m_value == 2);
+		REQUIRE(registry.get<Bar>(id)->m_name == "bar");
+	}
+
+	SECTION("Reusing a buffer") {
+		auto first = commands.emplace();
+		auto second = commands.emplace();
+		registry.flush(commands);
+		REQUIRE(registry.is_alive(commands.resolve(second)));
+
+		// every pass starts its placeholders over, and forgets the previous ones
+		for (int pass = 0; pass < 3; pass++) {
+			auto placeholder = commands.emplace();
+			REQUIRE(placeholder == first);
+			commands.emplace<Foo>(placeholder, Foo{pass});
+			registry.flush(commands);
+
+			auto id = commands.resolve(placeholder);
+			REQUIRE(registry.get<Foo>(id)->m_value == pass);
+			REQUIRE_THROWS_AS(commands.resolve(second), std::out_of_range);
+		}
+	}
+
+	SECTION("Later commands override earlier ones") {
+		auto id = registry.emplace();
+		registry.emplace<Foo>(id, Foo{1});
+
+		commands.emplace<Foo>(id, Foo{2});
+		commands.emplace<Bar>(id, Bar{"first"});
+		commands.emplace<Bar>(id, Bar{"second"});
+		commands.erase<Foo>(id);
+		registry.flush(commands);
+
+		REQUIRE_FALSE(registry.all_of<Foo>(id));
+		REQUIRE(registry.get<Bar>(id)->m_name == "second");
+
+		commands.emplace<Bar>(id, Bar{"third"});
+		commands.erase(id);
+		commands.emplace<Foo>(id, Foo{3});
+		registry.flush(commands);
+		REQUIRE_FALSE(registry.is_alive(id));
+	}
+
+	SECTION("Structural changes while iterating") {
+		std::vector<stch::EntityID> ids;
+		for (int i = 0; i < 100; i++) {
+			ids.push_back(registry.emplace());
+			registry.emplace<Foo>(ids.back(), Foo{i});
+		}
+
+		registry.each<Foo>([&](Foo & foo) {
+			auto id = ids[static_cast<std::size_t>(foo.m_value)];
+			if (foo.m_value % 2) {
+				commands.erase(id);
+			} else {
+				commands.emplace<Bar>(id, Bar{std::to_string(foo.m_value)});
+			}
+		});
+		registry.flush(commands);
+
+		for (std::size_t i = 0; i < ids.size(); i++) {
+			REQUIRE(registry.is_alive(ids[i]) == (i % 2 == 0));
+			if (i % 2 == 0) {
+				REQUIRE(registry.get<Foo>(ids[i])->m_value == static_cast<int>(i));
+				REQUIRE(registry.get<Bar>(ids[i])->m_name == std::to_string(i));
+			}
+		}
+	}
+
+	SECTION("Buffers filled from several threads") {
+		std::vector<stch::CommandBuffer> buffers(4);
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < buffers.size(); t++) {
+			threads.emplace_back([&, t] {
+				for (int i = 0; i < 1000; i++) {
+					auto placeholder = buffers[t].emplace();
+					buffers[t].emplace<Foo>(placeholder, Foo{static_cast<int>(t)});
+					if (i % 2) {
+						buffers[t].emplace<Bar>(placeholder, Bar{std::to_string(i)});
+					}
+				}
+			});
+		}
+		for (auto & thread : threads) {
+			thread.join();
+		}
+
+		registry.flush(buffers);
+
+		int foos = 0;
+		int bars = 0;
+		registry.each<Foo>([&](Foo &) { foos++; });
+		registry.each<Bar>([&](Bar &) { bars++; });
+		REQUIRE(foos == 4000);
+		REQUIRE(bars == 2000);
+	}
+}
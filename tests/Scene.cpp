@@ -2,8 +2,22 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include "Stitch/Scene.hpp"
+#include "Stitch/Workers.hpp"
 #include "catch2/catch_test_macros.hpp"
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <string>
+
 TEST_CASE("Scene") {
 	stch::Scene registry;
 
@@ -26,6 +40,15 @@ TEST_CASE("Scene") {
 				REQUIRE(registry.is_alive(entity2));
 				REQUIRE_FALSE(registry.is_alive(entity));
 			}
+
+			SECTION("Stale and forged handles are rejected") {
+				auto entity2 = registry.emplace();
+				REQUIRE(stch::entity::index(entity2) == stch::entity::index(entity));
+
+				auto forged = stch::entity::compose(stch::entity::index(entity2), stch::entity::generation(entity2) + 1);
+				REQUIRE_FALSE(registry.is_alive(forged));
+				REQUIRE_THROWS(registry.all_of<int>(entity));
+			}
 		}
 
 		SECTION("Default constructing component") {
@@ -99,3 +122,968 @@ TEST_CASE("Scene") {
 		}
 	}
 }
+
+TEST_CASE("Scene churn") {
+	stch::Scene registry;
+
+	struct Foo { stch::EntityID m_owner; };
+	struct Bar { stch::EntityID m_owner; };
+	struct Baz { stch::EntityID m_owner; };
+
+	std::mt19937 rng{1234};
+	std::vector<stch::EntityID> alive;
+	for (int i = 0; i < 1000; i++) {
+		alive.push_back(registry.emplace());
+	}
+
+	auto check = [&]() {
+		for (auto id : alive) {
+			REQUIRE(registry.is_alive(id));
+			if (auto * foo = registry.get<Foo>(id)) {
+				REQUIRE(foo->m_owner == id);
+			}
+			if (auto * bar = registry.get<Bar>(id)) {
+				REQUIRE(bar->m_owner == id);
+			}
+			if (auto * baz = registry.get<Baz>(id)) {
+				REQUIRE(baz->m_owner == id);
+			}
+		}
+	};
+
+	auto toggle = [&](auto tag, stch::EntityID id) {
+		using C = typename decltype(tag)::type;
+		if (registry.all_of<C>(id)) {
+			registry.erase<C>(id);
+		} else {
+			registry.emplace<C>(id, C{id});
+		}
+	};
+
+	for (int op = 0; op < 1'000'000; op++) {
+		auto & id = alive[rng() % alive.size()];
+
+		switch (rng() % 8) {
+		case 0:
+			registry.erase(id);
+			id = registry.emplace();
+			break;
+		case 1: case 2: case 3:
+			toggle(stch::id<Foo>{}, id);
+			break;
+		case 4: case 5:
+			toggle(stch::id<Bar>{}, id);
+			break;
+		default:
+			toggle(stch::id<Baz>{}, id);
+			break;
+		}
+
+		if (op % 100'000 == 0) {
+			check();
+		}
+	}
+
+	check();
+}
+
+TEST_CASE("Scene non-trivial components") {
+	static int live = 0;
+	struct Tracked {
+		std::string m_name;
+		Tracked(std::string name) : m_name(std::move(name)) { live++; }
+		Tracked(Tracked && other) : m_name(std::move(other.m_name)) { live++; }
+		~Tracked() { live--; }
+	};
+	struct Foo { int m_value; };
+
+	{
+		stch::Scene registry;
+
+		std::vector<stch::EntityID> ids;
+		for (int i = 0; i < 100; i++) {
+			auto id = registry.emplace();
+			registry.emplace<Tracked>(id, std::to_string(i));
+			ids.push_back(id);
+		}
+
+		// migrate everything back and forth, growing and shrinking pools
+		for (auto id : ids) {
+			registry.emplace<Foo>(id, Foo{1});
+		}
+		for (std::size_t i = 0; i < ids.size(); i += 2) {
+			registry.erase<Foo>(ids[i]);
+		}
+		for (std::size_t i = 0; i < ids.size(); i += 3) {
+			registry.erase(ids[i]);
+		}
+
+		REQUIRE(live == 100 - 34);
+		for (std::size_t i = 0; i < ids.size(); i++) {
+			if (i % 3) {
+				REQUIRE(registry.get<Tracked>(ids[i])->m_name == std::to_string(i));
+				REQUIRE(registry.all_of<Foo>(ids[i]) == (i % 2 == 1));
+			}
+		}
+	}
+
+	REQUIRE(live == 0);
+}
+
+TEST_CASE("Scene over-aligned components") {
+	stch::Scene registry;
+
+	struct alignas(64) Line { float m_values[16]; };
+	struct alignas(32) Vec { float m_values[8]; };
+
+	std::vector<stch::EntityID> ids;
+	for (int i = 0; i < 50; i++) {
+		auto id = registry.emplace();
+		registry.emplace<Vec>(id);
+		registry.emplace<Line>(id);
+		ids.push_back(id);
+	}
+
+	for (auto id : ids) {
+		REQUIRE(reinterpret_cast<std::uintptr_t>(registry.get<Line>(id)) % 64 == 0);
+		REQUIRE(reinterpret_cast<std::uintptr_t>(registry.get<Vec>(id)) % 32 == 0);
+	}
+}
+
+TEST_CASE("Scene batches") {
+	stch::Scene registry;
+
+	struct Foo { int m_value; };
+	struct Bar { std::string m_name; };
+
+	auto ids = registry.create_n(1000, Foo{7}, Bar{"bar"});
+	REQUIRE(ids.size() == 1000);
+	for (auto id : ids) {
+		REQUIRE(registry.get<Foo>(id)->m_value == 7);
+		REQUIRE(registry.get<Bar>(id)->m_name == "bar");
+	}
+
+	SECTION("Erasing many at once") {
+		std::vector<stch::EntityID> doomed;
+		std::vector<stch::EntityID> kept;
+		for (std::size_t i = 0; i < ids.size(); i++) {
+			(i % 3 == 0 || i > 900 ? doomed : kept).push_back(ids[i]);
+		}
+		for (std::size_t i = 0; i < kept.size(); i++) {
+			registry.get<Foo>(kept[i])->m_value = static_cast<int>(i);
+		}
+
+		registry.erase_n(doomed);
+
+		for (auto id : doomed) {
+			REQUIRE_FALSE(registry.is_alive(id));
+		}
+		for (std::size_t i = 0; i < kept.size(); i++) {
+			REQUIRE(registry.get<Foo>(kept[i])->m_value == static_cast<int>(i));
+			REQUIRE(registry.get<Bar>(kept[i])->m_name == "bar");
+		}
+
+		int count = 0;
+		registry.each<Foo>([&](Foo &) { count++; });
+		REQUIRE(count == static_cast<int>(kept.size()));
+	}
+
+	SECTION("Erasing by query") {
+		auto other = registry.emplace();
+		registry.emplace<Foo>(other, Foo{1});
+
+		registry.erase_all<Bar>();
+		for (auto id : ids) {
+			REQUIRE_FALSE(registry.is_alive(id));
+		}
+		REQUIRE(registry.is_alive(other));
+
+		auto again = registry.create_n(10, Foo{3}, Bar{"again"});
+		REQUIRE(registry.get<Bar>(again.back())->m_name == "again");
+	}
+}
+
+TEST_CASE("Scene multiple components") {
+	stch::Scene registry;
+
+	struct Foo { int m_value; };
+	struct Bar { std::string m_name; };
+	struct Baz { float m_value = 0.5f; };
+
+	auto id = registry.emplace();
+
+	SECTION("Default constructed") {
+		auto [bar, baz] = registry.emplace<Bar, Baz>(id);
+		REQUIRE(bar.m_name.empty());
+		REQUIRE(baz.m_value == 0.5f);
+		REQUIRE(registry.all_of<Bar, Baz>(id));
+	}
+
+	SECTION("From values") {
+		auto [foo, bar, baz] = registry.emplace<Foo, Bar, Baz>(id, Foo{1}, Bar{"bar"}, Baz{2.f});
+		REQUIRE(registry.get<Foo>(id) == &foo);
+		REQUIRE(registry.get<Bar>(id) == &bar);
+		REQUIRE(registry.get<Baz>(id) == &baz);
+		REQUIRE(bar.m_name == "bar");
+
+		SECTION("Replacing some while adding others") {
+			auto other = registry.emplace();
+			registry.emplace<Foo>(other, Foo{5});
+			registry.emplace<Foo, Bar>(other, Foo{6}, Bar{"other"});
+			REQUIRE(registry.get<Foo>(other)->m_value == 6);
+			REQUIRE(registry.get<Bar>(other)->m_name == "other");
+		}
+
+		SECTION("Removing several at once") {
+			registry.erase<Foo, Baz>(id);
+			REQUIRE_FALSE(registry.any_of<Foo, Baz>(id));
+			REQUIRE(registry.get<Bar>(id)->m_name == "bar");
+
+			registry.erase<Bar, Baz>(id);
+			REQUIRE_FALSE(registry.any_of<Foo, Bar, Baz>(id));
+		}
+	}
+}
+
+TEST_CASE("Scene chunked storage") {
+	stch::Scene registry(stch::Storage::Chunked);
+
+	struct Foo { int m_value; };
+	struct Bar { std::string m_name; };
+
+	auto first = registry.emplace();
+	auto [foo, bar] = registry.emplace<Foo, Bar>(first, Foo{-1}, Bar{"first"});
+
+	auto ids = registry.create_n(10000, Foo{7}, Bar{"bar"});
+	for (std::size_t i = 0; i < ids.size(); i++) {
+		registry.get<Foo>(ids[i])->m_value = static_cast<int>(i);
+	}
+
+	// growing added chunks instead of moving what was there
+	REQUIRE(&foo == registry.get<Foo>(first));
+	REQUIRE(&bar == registry.get<Bar>(first));
+	REQUIRE(bar.m_name == "first");
+
+	SECTION("Iterating spans every chunk") {
+		std::size_t runs = 0;
+		std::size_t rows = 0;
+		registry.each_chunk<Foo, Bar>([&](std::size_t n, Foo * foos, Bar * bars) {
+			runs++;
+			rows += n;
+			for (std::size_t i = 0; i < n; i++) {
+				REQUIRE((foos[i].m_value == -1 || bars[i].m_name == "bar"));
+			}
+		});
+		REQUIRE(rows == ids.size() + 1);
+		REQUIRE(runs > 1);
+	}
+
+	SECTION("Erasing backfills across chunks") {
+		std::vector<stch::EntityID> doomed(ids.begin(), ids.begin() + 5000);
+		registry.erase_n(doomed);
+		registry.erase<Bar>(ids[7000]);
+
+		for (std::size_t i = 5000; i < ids.size(); i++) {
+			REQUIRE(registry.get<Foo>(ids[i])->m_value == static_cast<int>(i));
+		}
+		REQUIRE_FALSE(registry.all_of<Bar>(ids[7000]));
+		REQUIRE(registry.get<Bar>(first)->m_name == "first");
+	}
+}
+
+TEST_CASE("Scene reserve") {
+	stch::Scene registry;
+
+	struct Foo { int m_value; };
+
+	registry.reserve<Foo>(1000);
+
+	auto first = registry.create_n(1, Foo{1}).front();
+	auto * foo = registry.get<Foo>(first);
+	registry.create_n(999, Foo{2});
+
+	REQUIRE(registry.get<Foo>(first) == foo);
+}
+
+// forwards to the default resource, keeping track of what is outstanding
+struct Counting : std::pmr::memory_resource {
+	std::size_t m_outstanding = 0;
+	std::size_t m_allocations = 0;
+	std::size_t m_allocated = 0; // bytes, in total
+
+	void * do_allocate(std::size_t bytes, std::size_t align) override {
+		m_outstanding += bytes;
+		m_allocations++;
+		m_allocated += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, align);
+	}
+
+	void do_deallocate(void * p, std::size_t bytes, std::size_t align) override {
+		m_outstanding -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override {
+		return this == &other;
+	}
+};
+
+TEST_CASE("Scene memory resource") {
+	struct Foo { int m_value; };
+	struct Bar { std::string m_name; };
+
+	// nothing the scene owns falls back to the default resource
+	struct Fallback {
+		Counting m_counting;
+		std::pmr::memory_resource * m_previous = std::pmr::set_default_resource(&m_counting);
+		~Fallback() { std::pmr::set_default_resource(m_previous); }
+	} fallback;
+
+	for (auto storage : {stch::Storage::Contiguous, stch::Storage::Chunked}) {
+		Counting resource;
+		{
+			stch::Scene registry(storage, &resource);
+
+			auto ids = registry.create_n(1000, Foo{1}, Bar{"bar"});
+			registry.erase<Bar>(ids.front());
+			registry.each<Foo>([](Foo & foo) { foo.m_value++; });
+			registry.query<Foo>();
+			registry.erase_n(ids);
+
+			REQUIRE(resource.m_allocations > 0);
+		}
+		REQUIRE(resource.m_outstanding == 0);
+	}
+
+	SECTION("Releasing an arena in one go") {
+		Counting upstream;
+		std::pmr::monotonic_buffer_resource arena(&upstream);
+		{
+			stch::Scene registry(stch::Storage::Chunked, &arena);
+			registry.create_n(1000, Foo{1});
+			REQUIRE(upstream.m_allocations > 0);
+		}
+		arena.release();
+		REQUIRE(upstream.m_outstanding == 0);
+	}
+
+	REQUIRE(fallback.m_counting.m_allocations == 0);
+}
+
+TEST_CASE("Scene tags") {
+	stch::Scene registry;
+
+	struct Foo { int m_value; };
+	struct Enemy {};
+	struct Dirty {};
+
+	auto ids = registry.create_n(100, Foo{1}, Enemy{});
+	auto plain = registry.create_n(50, Foo{2});
+
+	for (std::size_t i = 0; i < ids.size(); i += 2) {
+		registry.emplace<Dirty>(ids[i]);
+	}
+
+	REQUIRE(registry.all_of<Foo, Enemy, Dirty>(ids[0]));
+	REQUIRE(registry.get<Enemy>(ids[1]) != nullptr);
+	REQUIRE(registry.get<Dirty>(ids[1]) == nullptr);
+	REQUIRE(registry.get<Enemy>(plain[0]) == nullptr);
+	REQUIRE(registry.get<Foo>(ids[0])->m_value == 1);
+
+	int enemies = 0;
+	registry.each<Enemy, Foo>([&](Enemy &, Foo & foo) {
+		REQUIRE(foo.m_value == 1);
+		enemies++;
+	});
+	REQUIRE(enemies == 100);
+
+	int dirty = 0;
+	registry.each<Dirty>([&](Dirty &) { dirty++; });
+	REQUIRE(dirty == 50);
+
+	registry.erase<Enemy, Dirty>(ids[0]);
+	REQUIRE_FALSE(registry.any_of<Enemy, Dirty>(ids[0]));
+	REQUIRE(registry.get<Foo>(ids[0])->m_value == 1);
+
+	stch::CommandBuffer commands;
+	commands.emplace<Dirty>(plain[0]);
+	commands.erase<Enemy>(ids[1]);
+	registry.flush(commands);
+	REQUIRE(registry.all_of<Dirty>(plain[0]));
+	REQUIRE_FALSE(registry.all_of<Enemy>(ids[1]));
+	REQUIRE(registry.get<Foo>(plain[0])->m_value == 2);
+}
+
+struct Burning { std::string m_source; };
+struct Stunned {};
+
+template <>
+struct stch::is_sparse<Burning> : std::true_type {};
+template <>
+struct stch::is_sparse<Stunned> : std::true_type {};
+
+TEST_CASE("Scene sparse components") {
+	stch::Scene registry;
+
+	struct Foo { int m_value; };
+
+	auto ids = registry.create_n(100, Foo{1});
+	auto * foo = registry.get<Foo>(ids[10]);
+
+	for (std::size_t i = 0; i < ids.size(); i += 2) {
+		registry.emplace<Burning>(ids[i], Burning{"fire"});
+	}
+	registry.emplace<Stunned>(ids[10]);
+	registry.emplace<Stunned>(ids[11]);
+
+	// no archetype moves
+	REQUIRE(registry.get<Foo>(ids[10]) == foo);
+	REQUIRE(registry.all_of<Foo, Burning, Stunned>(ids[10]));
+	REQUIRE_FALSE(registry.any_of<Burning>(ids[11]));
+	REQUIRE(registry.get<Burning>(ids[0])->m_source == "fire");
+	REQUIRE(registry.get<Burning>(ids[1]) == nullptr);
+
+	int burning = 0;
+	registry.each<Foo, const Burning>([&](Foo & value, const Burning & effect) {
+		REQUIRE(effect.m_source == "fire");
+		value.m_value = 2;
+		burning++;
+	});
+	REQUIRE(burning == 50);
+	REQUIRE(registry.get<Foo>(ids[0])->m_value == 2);
+	REQUIRE(registry.get<Foo>(ids[1])->m_value == 1);
+
+	int both = 0;
+	registry.each<Burning, Stunned>([&](Burning &, Stunned &) { both++; });
+	REQUIRE(both == 1);
+
+	int calm = 0;
+	int optional = 0;
+	registry.each<Foo, stch::without<Burning>>([&](Foo &) { calm++; });
+	registry.each<Foo, stch::optional<Burning>>([&](Foo &, Burning * effect) { optional += effect != nullptr; });
+	REQUIRE(calm == 50);
+	REQUIRE(optional == 50);
+
+	stch::Workers workers{2};
+	std::atomic<int> parallel{0};
+	registry.par_each<Foo, Burning>(workers, [&](Foo &, Burning &) { parallel++; }, 8);
+	REQUIRE(parallel == 50);
+
+	SECTION("Removing") {
+		registry.erase<Burning>(ids[0]);
+		registry.erase<Foo, Stunned>(ids[10]);
+		REQUIRE_FALSE(registry.any_of<Burning>(ids[0]));
+		REQUIRE_FALSE(registry.any_of<Foo, Stunned>(ids[10]));
+		REQUIRE(registry.get<Burning>(ids[10])->m_source == "fire");
+
+		registry.erase(ids[2]);
+		registry.erase_all<Stunned>();
+		REQUIRE_FALSE(registry.is_alive(ids[11]));
+
+		burning = 0;
+		registry.each<Burning>([&](Burning &) { burning++; });
+		REQUIRE(burning == 48);
+	}
+
+	SECTION("Deferred") {
+		stch::CommandBuffer commands;
+		commands.emplace<Burning>(ids[1], Burning{"lava"});
+		commands.erase<Burning>(ids[0]);
+		registry.flush(commands);
+
+		REQUIRE(registry.get<Burning>(ids[1])->m_source == "lava");
+		REQUIRE_FALSE(registry.any_of<Burning>(ids[0]));
+		REQUIRE(registry.get<Foo>(ids[10]) == foo);
+	}
+}
+
+struct Health { int m_value; };
+
+template <>
+struct stch::is_tracked<Health> : std::true_type {};
+
+TEST_CASE("Scene change detection") {
+	stch::Scene registry(stch::Storage::Chunked);
+	struct Poisoned {};
+
+	auto ids = registry.create_n(5000, Health{100});
+	auto since = registry.advance();
+
+	auto count = [&](auto... terms) {
+		std::size_t matched = 0;
+		registry.each<decltype(terms)...>(since, [&](auto &&...) { matched++; });
+		return matched;
+	};
+
+	REQUIRE(count(stch::added<Health>{}) == 0);
+	REQUIRE(count(stch::changed<Health>{}) == 0);
+
+	std::size_t everything = 0;
+	registry.each<stch::added<Health>>(0, [&]() { everything++; });
+	REQUIRE(everything == ids.size());
+
+	SECTION("Writes are stamped") {
+		registry.get<Health>(ids[10])->m_value = 50;
+		auto late = registry.emplace();
+		registry.emplace<Health>(late, Health{1});
+
+		REQUIRE(count(stch::changed<Health>{}) == 2);
+		REQUIRE(count(stch::added<Health>{}) == 1);
+
+		// moving to another archetype keeps the ticks
+		registry.emplace<Poisoned>(ids[20]);
+		REQUIRE(count(stch::changed<Health>{}) == 2);
+
+		since = registry.advance();
+		REQUIRE(count(stch::changed<Health>{}) == 0);
+	}
+
+	SECTION("Const access does not mark") {
+		const auto & view = registry;
+		REQUIRE(view.get<Health>(ids[3])->m_value == 100);
+		registry.each<const Health>([](const Health &) {});
+		REQUIRE(count(stch::changed<Health>{}) == 0);
+
+		registry.each<Health>([](Health & health) { health.m_value--; });
+		REQUIRE(count(stch::changed<Health>{}) == ids.size());
+	}
+
+	SECTION("Quiet chunks are skipped") {
+		registry.get<Health>(ids.back())->m_value = 0;
+
+		std::size_t runs = 0;
+		std::size_t rows = 0;
+		registry.each_chunk<stch::changed<Health>, const Health>(since, [&](std::size_t size, const Health * health) {
+			runs++;
+			rows += size;
+			REQUIRE(health->m_value == 0);
+		});
+		REQUIRE(runs == 1);
+		REQUIRE(rows == 1);
+	}
+
+	SECTION("Deferred") {
+		stch::CommandBuffer commands;
+		commands.emplace<Health>(ids[0], Health{1});
+		registry.flush(commands);
+
+		REQUIRE(count(stch::changed<Health>{}) == 1);
+		REQUIRE(count(stch::added<Health>{}) == 0);
+	}
+}
+
+struct Label { std::string m_text; };
+struct Slowed { float m_factor; };
+
+template <>
+struct stch::serialise<Label> {
+	static void save(stch::Writer & out, const Label & label) {
+		out.write(label.m_text.size());
+		out.write(label.m_text.data(), label.m_text.size());
+	}
+
+	static Label load(stch::Reader & in) {
+		auto size = in.read<std::size_t>();
+		return {std::string(reinterpret_cast<const char *>(in.take(size)), size)};
+	}
+};
+
+template <>
+struct stch::is_sparse<Slowed> : std::true_type {};
+
+TEST_CASE("Scene snapshots") {
+	struct Position { float m_x, m_y; };
+	struct Frozen {};
+
+	stch::Scene registry(stch::Storage::Chunked);
+
+	auto ids = registry.create_n(3000, Position{1.f, 2.f});
+	for (std::size_t i = 0; i < ids.size(); i++) {
+		registry.get<Position>(ids[i])->m_x = static_cast<float>(i);
+	}
+	registry.emplace<Label>(ids[5], Label{"fifth"});
+	registry.emplace<Frozen>(ids[6]);
+	registry.emplace<Slowed>(ids[7], Slowed{0.5f});
+	auto bare = registry.emplace();
+	registry.erase(ids[8]);
+
+	std::stringstream stream;
+	registry.save(stream);
+
+	SECTION("Restoring") {
+		stch::Scene restored;
+		restored.restore<Position, Label, Frozen, Slowed>(stream);
+
+		REQUIRE(restored.is_alive(bare));
+		REQUIRE_FALSE(restored.is_alive(ids[8]));
+		REQUIRE(restored.get<Position>(ids[2999])->m_x == 2999.f);
+		REQUIRE(restored.get<Label>(ids[5])->m_text == "fifth");
+		REQUIRE(restored.all_of<Position, Frozen>(ids[6]));
+		REQUIRE(restored.get<Slowed>(ids[7])->m_factor == 0.5f);
+
+		std::size_t positions = 0;
+		restored.each<const Position>([&](const Position &) { positions++; });
+		REQUIRE(positions == 2999);
+
+		// ids keep being handed out as they would have been
+		REQUIRE(restored.emplace() == registry.emplace());
+	}
+
+	SECTION("Restoring over existing entities") {
+		stch::Scene restored;
+		auto stale = restored.create_n(10, Position{}, Label{"old"});
+		auto bytes = stream.str();
+		restored.restore<Frozen, Slowed>(reinterpret_cast<const std::byte *>(bytes.data()), bytes.size());
+
+		REQUIRE(restored.get<Position>(ids[1])->m_x == 1.f);
+		REQUIRE(restored.get<Label>(ids[5])->m_text == "fifth");
+		REQUIRE_FALSE(restored.any_of<Label>(stale[0]));
+	}
+
+	SECTION("Mapping") {
+		auto path = (std::filesystem::temp_directory_path() / "stitch-snapshot.bin").string();
+		{
+			std::ofstream file(path, std::ios::binary);
+			file << stream.rdbuf();
+		}
+
+		stch::Scene mapped;
+		mapped.map<Position, Label, Frozen, Slowed>(path);
+		REQUIRE(mapped.get<Position>(ids[2999])->m_x == 2999.f);
+		REQUIRE(mapped.get<Label>(ids[5])->m_text == "fifth");
+		REQUIRE(mapped.get<Slowed>(ids[7])->m_factor == 0.5f);
+
+		// writes stay private to the scene, and growing moves the column out
+		mapped.get<Position>(ids[0])->m_y = 7.f;
+		mapped.create_n(5000, Position{});
+		REQUIRE(mapped.get<Position>(ids[0])->m_y == 7.f);
+		REQUIRE(mapped.get<Position>(ids[100])->m_x == 100.f);
+
+		stch::Scene again;
+		again.map<Position, Label, Frozen, Slowed>(path);
+		REQUIRE(again.get<Position>(ids[0])->m_y == 2.f);
+
+		// mapping over a mapped scene
+		again.map<Position, Label, Frozen, Slowed>(path);
+		REQUIRE(again.get<Position>(ids[1])->m_x == 1.f);
+
+		REQUIRE_THROWS_AS(again.map(path + ".missing"), std::system_error);
+		REQUIRE(again.is_alive(ids[1]));
+
+		// the Position column is never given a buffer of its own
+		Counting copying;
+		Counting mapping;
+		{
+			stch::Scene copied(stch::Storage::Contiguous, &copying);
+			auto bytes = stream.str();
+			copied.restore<Position, Label, Frozen, Slowed>(reinterpret_cast<const std::byte *>(bytes.data()), bytes.size());
+
+			stch::Scene borrowing(stch::Storage::Contiguous, &mapping);
+			borrowing.map<Position, Label, Frozen, Slowed>(path);
+			REQUIRE(borrowing.get<Position>(ids[2999])->m_x == 2999.f);
+		}
+		auto column = (ids.size() - 4) * sizeof(Position);
+		REQUIRE(mapping.m_allocated + column / 2 < copying.m_allocated);
+		REQUIRE(mapping.m_outstanding == 0);
+
+		std::filesystem::remove(path);
+	}
+
+	SECTION("Failures") {
+		auto bytes = stream.str();
+
+		stch::Scene unaware;
+		REQUIRE_THROWS_AS(unaware.restore(reinterpret_cast<const std::byte *>(bytes.data()), bytes.size()), std::runtime_error);
+
+		stch::Scene truncated;
+		auto entity = truncated.emplace();
+		REQUIRE_THROWS_AS((truncated.restore<Position, Label, Frozen, Slowed>(reinterpret_cast<const std::byte *>(bytes.data()), bytes.size() / 2)), std::runtime_error);
+		REQUIRE_FALSE(truncated.is_alive(entity));
+
+		// the entity table: 3001 slot generations, then the recycle list holding ids[8]
+		std::uint64_t slots = ids.size() + 1;
+		auto table = bytes.find(std::string(reinterpret_cast<const char *>(&slots), sizeof(slots)));
+		REQUIRE(table != std::string::npos);
+		auto recycled = table + sizeof(slots) + slots * sizeof(std::uint32_t) + sizeof(std::uint64_t);
+		REQUIRE(bytes.compare(recycled, sizeof(std::uint32_t), std::string("\x08\0\0\0", 4)) == 0);
+
+		for (std::uint32_t corrupt : {std::uint32_t{9000}, std::uint32_t{0}}) { // out of range, alive
+			auto damaged = bytes;
+			std::memcpy(damaged.data() + recycled, &corrupt, sizeof(corrupt));
+
+			stch::Scene rejecting;
+			REQUIRE_THROWS_AS((rejecting.restore<Position, Label, Frozen, Slowed>(reinterpret_cast<const std::byte *>(damaged.data()), damaged.size())), std::runtime_error);
+			REQUIRE(rejecting.stats().m_entities == 0);
+		}
+
+		// a sparse block naming one entity twice
+		registry.emplace<Slowed>(bare, Slowed{0.25f});
+		std::stringstream twice;
+		registry.save(twice);
+		auto repeated = twice.str();
+		stch::EntityID pair[2] = {ids[7], bare};
+		auto block = repeated.find(std::string(reinterpret_cast<const char *>(pair), sizeof(pair)));
+		REQUIRE(block != std::string::npos);
+		std::memcpy(repeated.data() + block + sizeof(stch::EntityID), &ids[7], sizeof(stch::EntityID));
+
+		stch::Scene doubled;
+		REQUIRE_THROWS_AS((doubled.restore<Position, Label, Frozen, Slowed>(reinterpret_cast<const std::byte *>(repeated.data()), repeated.size())), std::runtime_error);
+		REQUIRE(doubled.stats().m_entities == 0);
+
+		struct Opaque { std::string m_text; };
+		registry.emplace<Opaque>(bare, Opaque{"no hook"});
+		std::stringstream rejected;
+		REQUIRE_THROWS_AS(registry.save(rejected), std::invalid_argument);
+	}
+}
+
+// counts its live instances; its load hook fails once the fuse runs out
+template <bool Sparse>
+struct Fragile {
+	static inline int s_live = 0;
+	static inline int s_fuse = -1;
+
+	Fragile() { s_live++; }
+	Fragile(const Fragile &) { s_live++; }
+	Fragile(Fragile &&) noexcept { s_live++; }
+	Fragile & operator=(const Fragile &) = default;
+	~Fragile() { s_live--; }
+};
+
+template <bool Sparse>
+struct stch::serialise<Fragile<Sparse>> {
+	static void save(stch::Writer &, const Fragile<Sparse> &) {}
+
+	static Fragile<Sparse> load(stch::Reader &) {
+		if (Fragile<Sparse>::s_fuse >= 0 && Fragile<Sparse>::s_fuse-- == 0) {
+			throw std::runtime_error("fuse");
+		}
+		return {};
+	}
+};
+
+template <>
+struct stch::is_sparse<Fragile<true>> : std::true_type {};
+
+TEST_CASE("Scene snapshot hooks that throw") {
+	stch::Scene registry;
+	auto ids = registry.create_n(100, Fragile<false>{}, Label{"a label long enough to be allocated"});
+	for (std::size_t i = 0; i < 10; i++) {
+		registry.emplace<Fragile<true>>(ids[i]);
+	}
+	REQUIRE(Fragile<false>::s_live == 100);
+	REQUIRE(Fragile<true>::s_live == 10);
+
+	std::stringstream stream;
+	registry.save(stream);
+	auto bytes = stream.str();
+
+	// half way through a column, then half way through the sparse block
+	for (auto fuse : {std::pair{50, -1}, std::pair{-1, 5}}) {
+		Fragile<false>::s_fuse = fuse.first;
+		Fragile<true>::s_fuse = fuse.second;
+
+		stch::Scene restored;
+		REQUIRE_THROWS_AS((restored.restore<Fragile<false>, Fragile<true>, Label>(reinterpret_cast<const std::byte *>(bytes.data()), bytes.size())), std::runtime_error);
+		REQUIRE(restored.stats().m_entities == 0);
+		REQUIRE(Fragile<false>::s_live == 100);
+		REQUIRE(Fragile<true>::s_live == 10);
+	}
+
+	Fragile<false>::s_fuse = -1;
+	Fragile<true>::s_fuse = -1;
+}
+
+TEST_CASE("Scene statistics") {
+	struct Position { float m_x; };
+	struct Velocity { float m_x; };
+
+	stch::Scene registry;
+	registry.time_migrations(true);
+
+	auto ids = registry.create_n(100, Position{});
+	for (auto id : ids) {
+		registry.emplace<Velocity>(id, Velocity{});
+	}
+	registry.erase<Velocity>(ids[0]);
+
+	auto stats = registry.stats();
+	REQUIRE(stats.m_entities == 100);
+	REQUIRE(stats.m_counters.m_migrations == 101);
+	REQUIRE(stats.m_counters.m_edge_misses == 1); // the back edge is linked with the forward one
+	REQUIRE(stats.m_counters.m_edge_hits == 100);
+	REQUIRE(stats.edge_hit_rate() > 0.97);
+	REQUIRE(stats.m_counters.m_reallocations > 0);
+	REQUIRE(stats.m_counters.m_steal_time.count() > 0);
+
+	std::size_t bytes = 0;
+	for (const auto & archetype : stats.m_archetypes) {
+		REQUIRE(archetype.m_entities <= archetype.m_capacity);
+		REQUIRE(archetype.m_wasted <= archetype.m_bytes);
+		for (const auto & column : archetype.m_columns) {
+			REQUIRE(column.m_bytes == archetype.m_capacity * sizeof(float));
+		}
+		bytes += archetype.m_bytes;
+	}
+	REQUIRE(bytes == stats.m_bytes);
+
+	registry.reset_stats();
+	stats = registry.stats();
+	REQUIRE(stats.m_counters.m_migrations == 0);
+	REQUIRE(stats.m_counters.m_reallocations == 0);
+	REQUIRE(stats.edge_hit_rate() == 0.0);
+	REQUIRE(stats.m_entities == 100);
+}
+
+TEST_CASE("Scene compaction") {
+	struct Position { float m_x; };
+	struct Velocity { float m_x; };
+	struct Name { std::string m_name; };
+
+	for (auto storage : {stch::Storage::Contiguous, stch::Storage::Chunked}) {
+		stch::Scene registry(storage);
+
+		auto & moving = registry.query<Position, Velocity>();
+		auto kept = registry.create_n(100, Position{1}, Health{5});
+		auto gone = registry.create_n(20000, Position{2}, Velocity{3}, Name{"gone"});
+		registry.emplace<Velocity>(kept[0], Velocity{4});
+		registry.emplace<Name>(kept[1], Name{"kept"});
+		registry.erase<Name>(kept[1]);
+		registry.erase_n(gone);
+		auto since = registry.advance();
+		registry.get<Health>(kept[2])->m_value = 7;
+
+		auto before = registry.stats();
+		registry.compact();
+		auto after = registry.stats();
+
+		// left: the empty archetype, {Position, Health} and {Position, Velocity, Health}
+		REQUIRE(before.m_archetypes.size() == 5);
+		REQUIRE(after.m_archetypes.size() == 3);
+		REQUIRE(after.m_bytes < before.m_bytes);
+		for (std::size_t i = 0; i < after.m_archetypes.size(); i++) {
+			REQUIRE(after.m_archetypes[i].m_id == i);
+		}
+
+		// entities, views, edges and change ticks survive
+		REQUIRE(registry.get<Position>(kept[99])->m_x == 1);
+		REQUIRE(registry.get<Velocity>(kept[0])->m_x == 4);
+		REQUIRE(moving.archetypes().size() == 1);
+
+		std::size_t changed = 0;
+		registry.each<stch::changed<Health>>(since, [&](auto &&...) { changed++; });
+		REQUIRE(changed == 1);
+
+		registry.emplace<Velocity>(kept[1], Velocity{5});
+		registry.emplace<Name>(kept[1], Name{"again"});
+		REQUIRE(moving.archetypes().size() == 2);
+
+		std::size_t rows = 0;
+		registry.each<Position, Velocity>([&](Position &, Velocity &) { rows++; });
+		REQUIRE(rows == 2);
+		REQUIRE(registry.get<Name>(kept[1])->m_name == "again");
+
+		// policy: keep empty archetypes, shrink only those below a quarter full
+		registry.erase(kept[0]);
+		registry.erase_n(std::vector<stch::EntityID>(kept.begin() + 10, kept.end()));
+
+		registry.compact({false, 0.0});
+		auto unshrunk = registry.stats();
+		REQUIRE(unshrunk.m_archetypes.size() == 4);
+
+		registry.compact({false, 0.25});
+		auto shrunk = registry.stats();
+		REQUIRE(shrunk.m_archetypes.size() == 4);
+		REQUIRE(shrunk.m_wasted < unshrunk.m_wasted);
+		REQUIRE(shrunk.m_archetypes[2].m_capacity == 0); // {Position, Velocity, Health}
+		REQUIRE(registry.get<Health>(kept[9])->m_value == 5);
+		REQUIRE(registry.get<Health>(kept[2])->m_value == 7);
+	}
+}
+
+TEST_CASE("Scene cloning and prefabs") {
+	struct Position { float m_x; };
+	struct Enemy {};
+	struct Unique { std::unique_ptr<int> m_value; };
+
+	for (auto storage : {stch::Storage::Contiguous, stch::Storage::Chunked}) {
+		stch::Scene registry(storage);
+
+		auto original = registry.emplace();
+		registry.emplace<Position, Label, Enemy>(original, Position{2}, Label{"grunt"}, Enemy{});
+		registry.emplace<Burning>(original, Burning{"torch"});
+		registry.emplace<Health>(original, Health{10});
+		auto since = registry.advance();
+
+		SECTION("Clone") {
+			auto archetypes = registry.stats().m_archetypes.size();
+			auto copies = registry.clone(original, 5000);
+			REQUIRE(copies.size() == 5000);
+			for (auto id : copies) {
+				REQUIRE(registry.all_of<Position, Label, Enemy, Burning, Health>(id));
+				REQUIRE(registry.get<Label>(id)->m_text == "grunt");
+				REQUIRE(registry.get<Burning>(id)->m_source == "torch");
+			}
+			REQUIRE(registry.stats().m_archetypes.size() == archetypes);
+
+			std::size_t added = 0;
+			registry.each<stch::added<Health>>(since, [&](auto &&...) { added++; });
+			REQUIRE(added == 5000);
+
+			registry.emplace<Unique>(original);
+			REQUIRE_THROWS_AS(registry.clone(original, 10), std::invalid_argument);
+			REQUIRE(registry.stats().m_entities == 5001);
+		}
+
+		SECTION("Prefab") {
+			stch::Prefab grunt(Position{3}, Label{"grunt"}, Enemy{}, Burning{"oil"}, Stunned{});
+
+			auto spawned = registry.instantiate(grunt, 3000);
+			REQUIRE(spawned.size() == 3000);
+			REQUIRE(registry.get<Label>(spawned.back())->m_text == "grunt");
+			REQUIRE(registry.get<Position>(spawned.front())->m_x == 3);
+			REQUIRE(registry.get<Burning>(spawned[1234])->m_source == "oil");
+			REQUIRE(registry.all_of<Enemy, Stunned>(spawned[42]));
+			REQUIRE_FALSE(registry.any_of<Health>(spawned[42]));
+
+			// the archetype it remembered is dropped and made again
+			registry.erase_n(spawned);
+			registry.compact();
+			spawned = registry.instantiate(grunt, 10);
+			REQUIRE(registry.get<Label>(spawned.back())->m_text == "grunt");
+
+			// and looked up anew in another scene
+			stch::Scene other(storage);
+			REQUIRE(other.get<Position>(other.instantiate(grunt).front())->m_x == 3);
+
+			auto copy = registry.prefab(original);
+			auto from_copy = registry.instantiate(copy, 2).back();
+			REQUIRE(registry.get<Health>(from_copy)->m_value == 10);
+			REQUIRE(registry.get<Burning>(from_copy)->m_source == "torch");
+			REQUIRE(registry.all_of<Enemy>(from_copy));
+		}
+	}
+}
+
+#ifdef STITCH_TRACE
+TEST_CASE("Scene trace hooks") {
+	static std::vector<std::string> events;
+	stch::trace::on_begin = [](const char * name) { events.push_back(std::string("+") + name); };
+	stch::trace::on_end = [](const char * name) { events.push_back(std::string("-") + name); };
+
+	struct Position { float m_x; };
+	stch::Scene registry;
+	auto id = registry.emplace();
+	registry.emplace<Position>(id);
+	registry.each<Position>([](Position &) {});
+
+	stch::trace::on_begin = nullptr;
+	stch::trace::on_end = nullptr;
+
+	REQUIRE(events == std::vector<std::string>{
+		"+stch::Scene::emplace", "-stch::Scene::emplace",
+		"+stch::Scene::emplace", "-stch::Scene::emplace",
+		"+stch::Scene::each", "-stch::Scene::each",
+	});
+}
+#endif
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Stitch/Schedule.hpp"
+#include "Stitch/Scene.hpp"
+#include "Stitch/Workers.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <thread>
+
+TEST_CASE("Schedule") {
+	stch::Scene registry;
+	stch::Workers workers(4);
+	stch::Schedule schedule(registry);
+
+	struct Position { float m_x; };
+	struct Velocity { float m_x; };
+	struct Volume { int m_level; };
+	struct Frozen {};
+
+	auto ids = registry.create_n(1000, Position{0.f}, Velocity{1.f}, Volume{0});
+	registry.emplace<Frozen>(ids[0]);
+
+	auto move = schedule.each<Position, const Velocity, stch::without<Frozen>>("move", [](Position & position, const Velocity & velocity) {
+		position.m_x += velocity.m_x;
+	});
+	auto audio = schedule.each<Volume>("audio", [](Volume & volume) {
+		volume.m_level++;
+	});
+	auto damp = schedule.each<Velocity>("damp", [](Velocity & velocity) {
+		velocity.m_x *= 0.5f;
+	});
+	auto read = schedule.each_chunk<const Position, const Volume>("read", [](std::size_t, const Position *, const Volume *) {});
+
+	SECTION("Stages") {
+		// move and audio touch disjoint components; damp writes what move reads,
+		// and read waits for both writers it depends on
+		const auto & stages = schedule.stages();
+		REQUIRE(stages.size() == 2);
+		REQUIRE(stages[0] == std::vector<std::size_t>{move, audio});
+		REQUIRE(stages[1] == std::vector<std::size_t>{damp, read});
+	}
+
+	SECTION("Running") {
+		schedule.run(workers);
+		schedule.run(workers);
+
+		// move ran before damp in both frames
+		REQUIRE(registry.get<Position>(ids[1])->m_x == 1.5f);
+		REQUIRE(registry.get<Position>(ids[0])->m_x == 0.f);
+		REQUIRE(registry.get<Velocity>(ids[1])->m_x == 0.25f);
+		REQUIRE(registry.get<Volume>(ids[999])->m_level == 2);
+
+		REQUIRE(schedule.timings().size() == schedule.size());
+		for (const auto & timing : schedule.timings()) {
+			REQUIRE(timing.m_runs == 2);
+			REQUIRE(timing.m_total >= timing.m_last);
+		}
+		REQUIRE(schedule.timings()[audio].m_name == "audio");
+	}
+
+	SECTION("Independent systems overlap") {
+		stch::Schedule waiting(registry);
+		std::atomic<int> arrived{0};
+
+		// each system waits for the other, which only finishes if they run together
+		auto rendezvous = [&](stch::Scene &) {
+			arrived++;
+			while (arrived < 2) {
+				std::this_thread::yield();
+			}
+		};
+		waiting.add<const Position>("first", rendezvous);
+		waiting.add<const Volume>("second", rendezvous);
+
+		REQUIRE(waiting.stages().size() == 1);
+		waiting.run(workers);
+		REQUIRE(arrived == 2);
+	}
+}
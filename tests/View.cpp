@@ -2,8 +2,12 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include "Stitch/Scene.hpp"
+#include "Stitch/Workers.hpp"
 #include "catch2/catch_test_macros.hpp"
 
+#include <atomic>
+#include <stdexcept>
+
 
 TEST_CASE("View") {
 	stch::Scene registry;
@@ -47,4 +51,127 @@ TEST_CASE("View") {
 		});
 		REQUIRE(count == 2);
 	}
+
+	SECTION("Looping chunks") {
+		int count = 0;
+		int chunks = 0;
+		registry.each_chunk<Foo, Bar>([&](std::size_t n, Foo * foos, Bar *) {
+			for (std::size_t i = 0; i < n; i++) {
+				REQUIRE(foos[i].m_val == 1234);
+				count++;
+			}
+			chunks++;
+		});
+		REQUIRE(count == 2);
+		REQUIRE(chunks == 2);
+	}
+
+	SECTION("Tag columns in chunks") {
+		registry.create_n(100, Foo{}, Bar{});
+
+		// tags have no column, every run is handed the same shared instance
+		Bar * shared = nullptr;
+		std::size_t count = 0;
+		registry.each_chunk<Foo, Bar>([&](std::size_t n, Foo *, Bar * bars) {
+			REQUIRE(bars != nullptr);
+			if (!shared) {
+				shared = bars;
+			}
+			REQUIRE(bars == shared);
+			count += n;
+		});
+		REQUIRE(count == 102);
+
+		registry.each<Bar>([&](Bar & bar) { REQUIRE(&bar == shared); });
+	}
+
+	SECTION("Cached views pick up new archetypes") {
+		auto & view = registry.query<Foo>();
+		REQUIRE(&view == &registry.query<Foo>());
+
+		int count = 0;
+		registry.each<Foo>([&](auto &) { count++; });
+		REQUIRE(count == 2);
+
+		id = registry.emplace();
+		registry.emplace<Baz>(id);
+		registry.emplace<Foo>(id);
+
+		count = 0;
+		registry.each<Foo>([&](auto &) { count++; });
+		REQUIRE(count == 3);
+
+		count = 0;
+		for (auto [container, row] : view) {
+			count++;
+		}
+		REQUIRE(count == 3);
+	}
+
+	SECTION("Filtering with query terms") {
+		struct Qux { int m_val; };
+		auto first = registry.query<Foo, Bar, Baz>().archetypes().front()->m_entities.front();
+		registry.emplace<Qux>(first, Qux{7});
+
+		int count = 0;
+		registry.each<Foo, stch::without<Baz>>([&](Foo &) { count++; });
+		REQUIRE(count == 1);
+
+		count = 0;
+		registry.each<stch::with<Baz>, Foo>([&](Foo &) { count++; });
+		REQUIRE(count == 1);
+
+		int present = 0;
+		int missing = 0;
+		registry.each<Foo, stch::optional<Qux>>([&](Foo &, Qux * qux) {
+			(qux ? present : missing)++;
+			REQUIRE((!qux || qux->m_val == 7));
+		});
+		REQUIRE(present == 1);
+		REQUIRE(missing == 1);
+
+		registry.each_chunk<stch::optional<Qux>, stch::without<Baz>>([&](std::size_t n, Qux * quxes) {
+			REQUIRE(n == 1);
+			REQUIRE(quxes == nullptr);
+		});
+
+		registry.erase_all<Foo, stch::without<Qux>>();
+		REQUIRE(registry.is_alive(first));
+		REQUIRE_FALSE(registry.is_alive(id));
+	}
+
+	SECTION("Looping in parallel") {
+		for (int i = 0; i < 10000; i++) {
+			auto extra = registry.emplace();
+			registry.emplace<Foo>(extra);
+			if (i % 3 == 0) {
+				registry.emplace<Baz>(extra);
+			}
+		}
+
+		stch::Workers workers{4};
+		registry.par_each<Foo>(workers, [](Foo & foo) {
+			foo.m_val++;
+		}, 64);
+
+		int count = 0;
+		registry.each<Foo>([&](Foo & foo) {
+			REQUIRE(foo.m_val == 1235);
+			count++;
+		});
+		REQUIRE(count == 10002);
+
+		// the first error comes back to the caller once every worker has stopped
+		std::atomic<int> visited{0};
+		REQUIRE_THROWS_AS(registry.par_each<Foo>(workers, [&](Foo &) {
+			if (visited++ == 5000) {
+				throw std::runtime_error("callback failed");
+			}
+		}, 64), std::runtime_error);
+		REQUIRE(visited < 10002);
+
+		std::atomic<int> again{0};
+		registry.par_each<Foo>(workers, [&](Foo &) { again++; }, 64);
+		REQUIRE(again == 10002);
+	}
 }